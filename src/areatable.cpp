@@ -0,0 +1,110 @@
+/*
+ * Flat table of article option areas, and the vector kernel that tests
+ * blocks of candidate areas against the page bounds.
+ */
+
+#include "areatable.hpp"
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+namespace {
+  // round n up to a whole number of cache lines
+  int padded(int n) {
+    return (n + areaTable::LANES - 1) / areaTable::LANES * areaTable::LANES;
+  }
+}
+
+areaTable::areaTable(const Page &p) :
+  tailArticles_(0) {
+  const int n = p.end() - p.begin();
+  tailArticles_ = std::min(n, 2);
+  int total = 0;
+  for (auto &art : p) {
+    offsets_.push_back(total);
+    sizes_.push_back(art.size());
+    total += padded(art.size());
+  }
+  // the tail row: every pair from the last two articles
+  int tail = 1;
+  for (int j = n - tailArticles_; j < n; ++j)
+    tail *= p[j].size();
+  offsets_.push_back(total);
+  sizes_.push_back(tail);
+  total += padded(tail);
+
+  buffer_.assign(total + LANES, HUGE_VAL);
+  std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(buffer_.data());
+  base_ = buffer_.data() + ((64 - addr % 64) % 64) / sizeof(double);
+
+  for (int j = 0; j < n; ++j) {
+    double *r = base_ + offsets_[j];
+    for (auto &opt : p[j])
+      *r++ = opt.area();
+  }
+  double *r = base_ + offsets_.back();
+  if (tailArticles_ == 0) {
+    r[0] = 0;
+  } else if (tailArticles_ == 1) {
+    for (auto &opt : p[n-1])
+      *r++ = opt.area();
+  } else {
+    for (auto &a : p[n-2])
+      for (auto &b : p[n-1])
+	*r++ = a.area() + b.area();
+  }
+}
+
+
+unsigned int areaTable::blockScalar(const double *row, double base, double lo, double hi) {
+  unsigned int mask = 0;
+  for (int i = 0; i < LANES; ++i) {
+    double v = base + row[i];
+    if (v >= lo && v <= hi) mask |= 1u << i;
+  }
+  return mask;
+}
+
+#if defined(__AVX2__)
+
+unsigned int areaTable::block(const double *row, double base, double lo, double hi) {
+  const __m256d b = _mm256_set1_pd(base);
+  const __m256d l = _mm256_set1_pd(lo);
+  const __m256d h = _mm256_set1_pd(hi);
+  __m256d v0 = _mm256_add_pd(b, _mm256_load_pd(row));
+  __m256d v1 = _mm256_add_pd(b, _mm256_load_pd(row + 4));
+  __m256d m0 = _mm256_and_pd(_mm256_cmp_pd(v0, l, _CMP_GE_OQ),
+			     _mm256_cmp_pd(v0, h, _CMP_LE_OQ));
+  __m256d m1 = _mm256_and_pd(_mm256_cmp_pd(v1, l, _CMP_GE_OQ),
+			     _mm256_cmp_pd(v1, h, _CMP_LE_OQ));
+  return _mm256_movemask_pd(m0) | (_mm256_movemask_pd(m1) << 4);
+}
+
+#elif defined(__SSE2__)
+
+unsigned int areaTable::block(const double *row, double base, double lo, double hi) {
+  const __m128d b = _mm_set1_pd(base);
+  const __m128d l = _mm_set1_pd(lo);
+  const __m128d h = _mm_set1_pd(hi);
+  unsigned int mask = 0;
+  for (int i = 0; i < LANES; i += 2) {
+    __m128d v = _mm_add_pd(b, _mm_load_pd(row + i));
+    __m128d m = _mm_and_pd(_mm_cmpge_pd(v, l), _mm_cmple_pd(v, h));
+    mask |= _mm_movemask_pd(m) << i;
+  }
+  return mask;
+}
+
+#else
+
+unsigned int areaTable::block(const double *row, double base, double lo, double hi) {
+  return blockScalar(row, base, lo, hi);
+}
+
+#endif
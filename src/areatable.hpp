@@ -0,0 +1,79 @@
+/*
+ * Flat table of article option areas, for the inner loops of option
+ * selection.
+ */
+
+#ifndef AREATABLE_HPP
+#define AREATABLE_HPP
+
+#include "data.hpp"
+#include <vector>
+
+/*
+ * Structure-of-arrays copy of the option areas on a page.
+ *
+ * Each article's areas are held in one row of a single contiguous
+ * buffer. Every row starts on a cache line and is padded to a whole
+ * number of cache lines with +infinity, which no bound ever admits, so
+ * vector loops can always run whole blocks.
+ *
+ * A final row holds the pairwise sums of the last two articles' areas
+ * (option of the second-last article major), so that each step of a
+ * search over the other articles can test all of their combinations at
+ * once.
+ */
+class areaTable {
+public:
+  // doubles per 64-byte cache line; also the block size of scan()
+  static const int LANES = 8;
+private:
+  std::vector<double> buffer_;
+  // start of the first cache-aligned element in buffer_
+  double *base_;
+  // offset of each row from base_; the tail row comes last
+  std::vector<int> offsets_;
+  // number of real (unpadded) entries in each row
+  std::vector<int> sizes_;
+  // number of articles contributing to the tail row (0, 1 or 2)
+  int tailArticles_;
+public:
+  explicit areaTable(const Page &p);
+  areaTable(const areaTable &) = delete;
+  areaTable & operator=(const areaTable &) = delete;
+
+  const double *row(int article) const { return base_ + offsets_[article]; }
+  int size(int article) const { return sizes_[article]; }
+
+  const double *tail() const { return base_ + offsets_.back(); }
+  int tailSize() const { return sizes_.back(); }
+  int tailArticles() const { return tailArticles_; }
+
+  /*
+   * Call found(i) for each i in [0,count) for which
+   * lo <= base + row[i] <= hi.
+   * row must be cache-aligned and padded as rows of this table are.
+   * Uses AVX2 or SSE2 where the compiler targets them.
+   */
+  template <class F>
+  static void scan(const double *row, int count,
+		   double base, double lo, double hi, F found) {
+    for (int i = 0; i < count; i += LANES) {
+      unsigned int mask = block(row + i, base, lo, hi);
+      while (mask) {
+	int bit = __builtin_ctz(mask);
+	mask &= mask - 1;
+	found(i + bit);
+      }
+    }
+  }
+
+  /*
+   * One block of LANES entries: bit i of the result is set
+   * if lo <= base + row[i] <= hi.
+   */
+  static unsigned int block(const double *row, double base, double lo, double hi);
+  // the same, without vector instructions
+  static unsigned int blockScalar(const double *row, double base, double lo, double hi);
+};
+
+#endif // ndef AREATABLE_HPP
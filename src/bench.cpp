@@ -0,0 +1,158 @@
+/*
+ * Micro-benchmarks for the option selection and layout inner loops,
+ * run on synthetic pages so that no LaTeX is needed.
+ */
+
+#include "data.hpp"
+#include "areatable.hpp"
+#include "layout_worst.hpp"
+#include "layout_maxrects.hpp"
+#include "layout_bitboard.hpp"
+#include "layout_skyline.hpp"
+#include "layout_guillotine.hpp"
+#include "layout_beam.hpp"
+#include "layout_anneal.hpp"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+/*
+ * Is a > b within eps of a measurement unit?
+ */
+bool dblGt(const double a, const double b, const double eps) {
+  return (a - eps > b);
+}
+
+/*
+ * Is a < b within eps of a measurement unit?
+ * Note that this is not the inverse of dblGt
+ */
+bool dblLt(const double a, const double b, const double eps) {
+  return (a + eps < b);
+}
+
+std::ostream& operator<< (std::ostream& out, const area &a) {
+  out << '[' << a.w_ << "x" << a.h_ << '@'
+      << a.x_ << "," << a.y_ << ']';
+  return out;
+}
+
+
+/*
+ * A broadsheet-ish page of 6 columns, with articles of 1-5 columns each
+ * set in 12pt lines under a 30pt headline.
+ */
+Page syntheticPage(int articles, unsigned int seed, double height = 1400) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> lines(10, 80);
+  Page p(6 * 150.0 + 5 * 10, height);
+  for (int i = 0; i < articles; ++i) {
+    auto &art = p.newArticle("article" + std::to_string(i) + ".art");
+    int text = lines(rng);
+    for (int c = 1; c <= 5; ++c)
+      art.addOption(c, c * 150.0 + (c-1) * 10, 30 + 12 * ((text + c - 1) / c));
+  }
+  return p;
+}
+
+template <class F>
+double seconds(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+  return d.count();
+}
+
+/*
+ * The evaluation loop findBestOptions used to run: every combination
+ * re-summed through Page -> Article -> ArticleOption.
+ */
+double legacyLoop(const Page &p) {
+  const double target = p.width() * p.height();
+  double bestArea = 0;
+  for (combinationCursor c(p); !c.done(); c.next()) {
+    double area = 0;
+    int j=0;
+    for (auto idx : *c)
+      area += p[j++][idx].area();
+    if (area <= target && area > bestArea)
+      bestArea = area;
+  }
+  return bestArea;
+}
+
+void benchOptionArea() {
+  Page p = syntheticPage(9, 1);
+  std::cout << "Option area evaluation, " << p.combinations()
+	    << " combinations:" << std::endl;
+  double before = seconds([&]() { legacyLoop(p); });
+  double after = seconds([&]() { p.findBestOptions(optionSolver::exhaustive); });
+  std::cout << "  per-combination loop: " << before << "s" << std::endl
+	    << "  areaTable kernel:     " << after << "s"
+	    << " (x" << before / after << ')' << std::endl;
+
+  // the kernel alone, vector against scalar
+  const areaTable table(p);
+  const int reps = 2000000;
+  double sink = 0;
+  double scalar = seconds([&]() {
+      for (int r = 0; r < reps; ++r)
+	sink += areaTable::blockScalar(table.tail(), r, 0, 2e6);
+    });
+  double vector = seconds([&]() {
+      for (int r = 0; r < reps; ++r)
+	sink += areaTable::block(table.tail(), r, 0, 2e6);
+    });
+  std::cout << "  " << reps << " blocks of " << areaTable::LANES
+	    << ": scalar " << scalar << "s, vector " << vector << "s"
+	    << " (x" << scalar / vector << ")" << (sink < 0 ? " " : "")
+	    << std::endl;
+}
+
+/*
+ * Layout routine T on pages of articles..articles+4 articles, laying out
+ * the best combination of options for each.
+ * On short pages that often needs backtracking, if it lays out at all.
+ */
+template <class T>
+void benchBacktracking(const std::string & name, unsigned int count = 200,
+		       int articles = 8, double height = 1000,
+		       optionSolver solver = optionSolver::branchBound) {
+  unsigned long placements = 0;
+  int pages = 0, failed = 0;
+  double t = 0;
+  for (unsigned int seed = 1; seed <= count; ++seed) {
+    Page p = syntheticPage(articles + seed % 5, seed, height);
+    T layout;
+    try {
+      auto combo = p.sortArticlesBySize(p.findBestOptions(solver));
+      t += seconds([&]() {
+	  try { layout(p, combo); } catch (const char *) { ++failed; }
+	});
+    } catch (const char *) {
+      continue; // no combination fits the page at all
+    }
+    placements += layout.attempts();
+    ++pages;
+  }
+  std::cout << "Layout backtracking, " << name << ": " << pages << " pages ("
+	    << failed << " without a layout), " << placements
+	    << " placements in " << t << "s (" << placements / t
+	    << " placements/s)" << std::endl;
+}
+
+int main() {
+  benchOptionArea();
+  benchBacktracking<layout::worstFit<> >("worst");
+  benchBacktracking<layout::maxRects<layout::fitRule::bestShortSide> >("maxrects");
+  benchBacktracking<layout::maxRects<layout::fitRule::bestArea> >("maxrects-area");
+  benchBacktracking<layout::maxRects<layout::fitRule::contactPoint> >("maxrects-contact");
+  benchBacktracking<layout::skyline>("skyline");
+  benchBacktracking<layout::guillotine>("guillotine");
+  benchBacktracking<layout::beamSearch>("beam");
+  benchBacktracking<layout::annealing>("anneal");
+  // many articles on a tall page
+  benchBacktracking<layout::bitboard>("bitboard", 12, 20, 2600,
+				      optionSolver::quantizedDP);
+}
@@ -0,0 +1,621 @@
+/*
+ * Regression checks for the option solvers and layout engines, run on
+ * random pages so that no LaTeX is needed. Exits non-zero if any check
+ * fails.
+ */
+
+#include "data.hpp"
+#include "layout_engines.hpp"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Is a > b within eps of a measurement unit?
+ */
+bool dblGt(const double a, const double b, const double eps) {
+  return (a - eps > b);
+}
+
+/*
+ * Is a < b within eps of a measurement unit?
+ * Note that this is not the inverse of dblGt
+ */
+bool dblLt(const double a, const double b, const double eps) {
+  return (a + eps < b);
+}
+
+std::ostream& operator<< (std::ostream& out, const area &a) {
+  out << '[' << a.w_ << "x" << a.h_ << '@'
+      << a.x_ << "," << a.y_ << ']';
+  return out;
+}
+
+namespace {
+
+int checks = 0, failures = 0;
+
+void check(bool ok, const std::string & what) {
+  ++checks;
+  if (ok) return;
+  ++failures;
+  std::cout << "FAILED: " << what << std::endl;
+}
+
+/*
+ * Run f with the solvers' and layouts' progress output thrown away.
+ */
+template <class F>
+void quietly(F f) {
+  std::streambuf *out = std::cout.rdbuf(nullptr);
+  try {
+    f();
+  } catch (...) {
+    std::cout.rdbuf(out);
+    std::cout.clear();
+    throw;
+  }
+  std::cout.rdbuf(out);
+  std::cout.clear();
+}
+
+/*
+ * A page of 6 columns with articles of 1-5 options each, of random
+ * width and text length, and a raster or two of one option; some
+ * articles are copies of others, as interchangeable articles are.
+ */
+Page randomPage(int articles, unsigned int seed, double height) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> lines(5, 60), cols(1, 5), coin(0, 5);
+  Page p(6 * 150.0 + 5 * 10, height);
+  for (int i = 0; i < articles; ++i) {
+    if (i > 0 && coin(rng) == 0) {
+      // a twin of the previous article
+      Article copy = p.back();
+      auto &art = p.newArticle("article" + std::to_string(i) + ".art");
+      for (auto &opt : copy)
+	art.addOption(opt.numCols(), opt.layoutWidth(), opt.layoutHeight());
+      continue;
+    }
+    if (coin(rng) == 1) {
+      auto &art = p.newArticle("RASTER");
+      int c = cols(rng);
+      art.addOption(c, c * 150.0 + (c-1) * 10, 12 * lines(rng));
+      continue;
+    }
+    auto &art = p.newArticle("article" + std::to_string(i) + ".art");
+    int text = lines(rng);
+    int options = cols(rng);
+    for (int c = 1; c <= options; ++c)
+      art.addOption(c, c * 150.0 + (c-1) * 10, 30 + 12 * ((text + c - 1) / c));
+  }
+  return p;
+}
+
+std::string describe(const char *what, unsigned int seed) {
+  std::ostringstream out;
+  out << what << " (seed " << seed << ")";
+  return out.str();
+}
+
+/*
+ * The area of the combination solver picks for p, or 0 if it finds
+ * none.
+ */
+double solve(const Page & p, optionSolver solver, int threads = 1,
+	     int quantum = 65536, const layout::stopToken &stop = layout::stopToken()) {
+  std::vector<int> combo;
+  try {
+    quietly([&]() { combo = p.findBestOptions(solver, threads, quantum, stop); });
+  } catch (const char *) {
+    return 0;
+  }
+  return p.area(combo);
+}
+
+/*
+ * Every solver against exhaustive search. The exact solvers must find
+ * the same area. quantizedDP rounds option areas up to whole units and
+ * the page's down, so it need only match, to within a unit per article,
+ * the best fill of a page a unit per article and one more smaller; and
+ * it must never overflow the page.
+ */
+void checkSolvers(unsigned int count) {
+  for (unsigned int seed = 1; seed <= count; ++seed) {
+    std::mt19937 rng(seed);
+    const int articles = 3 + seed % 7;
+    const double height = std::uniform_real_distribution<double>(300, 1400)(rng);
+    const Page p = randomPage(articles, seed, height);
+    const double best = solve(p, optionSolver::exhaustive);
+    const double slack = p.width() * p.height() * 1e-9;
+
+    check(std::fabs(solve(p, optionSolver::branchBound) - best) <= slack,
+	  describe("branch and bound matches exhaustive search", seed));
+    check(std::fabs(solve(p, optionSolver::branchBound, 3) - best) <= slack,
+	  describe("threaded branch and bound matches exhaustive search", seed));
+    check(std::fabs(solve(p, optionSolver::meetInMiddle) - best) <= slack,
+	  describe("meet-in-the-middle matches exhaustive search", seed));
+
+    const int quantum = 4 * 65536;
+    const double unit = 16.0;
+    const double dp = solve(p, optionSolver::quantizedDP, 1, quantum);
+    check(!dblGt(dp, p.width() * p.height()),
+	  describe("quantised dp fits the page", seed));
+    // whatever fits a page short by a unit per article and one more
+    const Page shorter = randomPage(articles, seed,
+				    height - (articles + 1) * unit / p.width());
+    const double floor = solve(shorter, optionSolver::exhaustive);
+    check(!dblGt(dp, best) && !dblLt(dp, floor - articles * unit),
+	  describe("quantised dp is within a unit per article of the best", seed));
+  }
+}
+
+/*
+ * Meet-in-the-middle on pages too big for exhaustive search, against
+ * branch and bound: many one-option rasters after many articles of five
+ * options, which an even split by article count would overflow; and
+ * many copies of one article, which give many equal sums to pair.
+ */
+void checkMeetInMiddle() {
+  Page uneven(6 * 150.0 + 5 * 10, 4000);
+  for (int i = 0; i < 12; ++i) {
+    auto &art = uneven.newArticle("article" + std::to_string(i) + ".art");
+    for (int c = 1; c <= 5; ++c)
+      art.addOption(c, c * 150.0 + (c-1) * 10, 30 + 12 * ((20 + 7 * i + c - 1) / c));
+  }
+  for (int i = 0; i < 12; ++i)
+    uneven.newArticle("RASTER").addOption(1, 150.0, 60 + 12 * i);
+
+  Page same(6 * 150.0 + 5 * 10, 2000);
+  for (int i = 0; i < 30; ++i) {
+    auto &art = same.newArticle("article" + std::to_string(i) + ".art");
+    art.addOption(1, 150.0, 150);
+    art.addOption(2, 310.0, 84);
+  }
+
+  // the largest pair overflows the page by a rounding hair
+  Page hair(100, 100);
+  hair.newArticle("a.art").addOption(1, 50.00000001, 100);
+  hair.newArticle("b.art").addOption(1, 50, 100);
+  hair.back().addOption(1, 10, 100);
+
+  for (const Page *p : { &uneven, &same, &hair }) {
+    const double slack = p->width() * p->height() * 1e-9;
+    const double best = solve(*p, optionSolver::branchBound);
+    check(best > 0 && std::fabs(solve(*p, optionSolver::meetInMiddle) - best) <= slack,
+	  p == &same ? "meet-in-the-middle pairs equal sums"
+	  : p == &hair ? "meet-in-the-middle steps past pairs that overflow"
+	  : "meet-in-the-middle splits by combinations, not articles");
+  }
+}
+
+/*
+ * Solvers stopped before they start still give a combination that fits,
+ * if the smallest options do, and the option stream gives none.
+ */
+void checkStopped(unsigned int count) {
+  layout::stopToken stopped;
+  stopped.requestStop();
+  for (unsigned int seed = 1; seed <= count; ++seed) {
+    const Page p = randomPage(3 + seed % 7, seed, 900);
+    std::vector<int> smallest(p.end() - p.begin(), 0);
+    const bool fits = !(p.area(smallest) > p.width() * p.height());
+    for (optionSolver solver : { optionSolver::exhaustive, optionSolver::branchBound,
+	  optionSolver::meetInMiddle, optionSolver::quantizedDP })
+      for (int threads : { 1, 3 }) {
+	const double area = solve(p, solver, threads, 65536, stopped);
+	check(fits ? area > 0 && !(area > p.width() * p.height()) : area == 0,
+	      describe("a stopped solver gives a combination that fits", seed));
+      }
+    std::vector<int> combo;
+    optionStream stream(p, stopped);
+    check(!stream.next(combo), describe("a stopped option stream gives nothing", seed));
+  }
+}
+
+/*
+ * Does layout place every article of p once, in an option of its own,
+ * on the page and clear of the others?
+ */
+bool valid(const Page & p, const std::list<layout::articlePlacement> & layout) {
+  std::vector<int> seen(p.end() - p.begin(), 0);
+  std::vector<area> placed;
+  for (auto &r : layout) {
+    const int i = &r.art_ - &*p.begin();
+    if (i < 0 || i >= int(seen.size()) || &p[i] != &r.art_ || seen[i]++)
+      return false;
+    bool own = false;
+    for (auto &opt : r.art_)
+      own = own || &opt == &r.opt_;
+    const area &a = r.area_;
+    if (!own || dblLt(a.w_, r.opt_.layoutWidth()) || dblLt(a.h_, r.opt_.layoutHeight()) ||
+	dblLt(a.x_, 0) || dblLt(a.y_, 0) ||
+	dblGt(a.x2(), p.width()) || dblGt(a.y2(), p.height()))
+      return false;
+    for (auto &b : placed)
+      if (dblLt(a.x_, b.x2()) && dblLt(b.x_, a.x2()) &&
+	  dblLt(a.y_, b.y2()) && dblLt(b.y_, a.y2()))
+	return false;
+    placed.push_back(a);
+  }
+  return layout.size() == seen.size();
+}
+
+/*
+ * Two copies of one article, where only the layout giving the earlier
+ * copy the smaller option fits: the search must not rule it out.
+ */
+void checkTwinLayouts() {
+  Page p(6 * 150.0 + 5 * 10, 886.53876695115446);
+  p.newArticle("RASTER").addOption(4, 630, 444);
+  for (auto name : {"twin1.art", "twin2.art"}) {
+    auto &art = p.newArticle(name);
+    art.addOption(1, 150, 642);
+    art.addOption(2, 310, 342);
+  }
+  const std::vector<std::vector<double> > others {
+    {498, 270, 186, 150}, {546, 294, 210}, {294, 162, 126, 102},
+    {234, 138, 102}, {114, 78, 66, 54, 54}, {234, 138, 102}
+  };
+  for (auto &heights : others) {
+    auto &art = p.newArticle("article" + std::to_string(p.end() - p.begin()) + ".art");
+    for (unsigned int c = 1; c <= heights.size(); ++c)
+      art.addOption(c, c * 150.0 + (c-1) * 10, heights[c-1]);
+  }
+  const std::vector<int> combo {0, 1, 1, 1, 0, 3, 1, 4, 0};
+  for (auto name : {"worst", "maxrects", "skyline"}) {
+    auto e = layout::makeEngine(std::string(name));
+    bool ok = false;
+    quietly([&]() {
+	try { ok = valid(p, e(p, combo)); } catch (const char *) {}
+      });
+    check(ok, std::string(name) + " lays out twins in either order of options");
+  }
+}
+
+// options dropped below combo by layout
+int dropped(const Page & p, const std::vector<int> & combo,
+	    const std::list<layout::articlePlacement> & layout) {
+  int total = 0;
+  for (auto &r : layout)
+    total += combo[&r.art_ - &*p.begin()] - (&r.opt_ - &*r.art_.begin());
+  return total;
+}
+
+/*
+ * The guillotine layout drops the fewest options it can: no choice of
+ * smaller options dropping fewer has a layout of its own. And it turns
+ * down a grid too wide for its memo key.
+ */
+void checkGuillotine(unsigned int count) {
+  for (unsigned int seed = 1; seed <= count; ++seed) {
+    std::mt19937 rng(seed);
+    const double height = std::uniform_real_distribution<double>(300, 900)(rng);
+    const Page p = randomPage(4, seed, height);
+    std::vector<int> combo;
+    for (auto &art : p)
+      combo.push_back(art.size() - 1);
+    layout::guillotine g;
+    int least = -1;
+    quietly([&]() {
+	try {
+	  auto &result = g(p, combo);
+	  check(valid(p, result), describe("guillotine layout is valid", seed));
+	  least = dropped(p, combo, result);
+	} catch (const char *) {}
+      });
+    if (least <= 0) continue;
+    // every smaller choice, by mixed-radix count
+    std::vector<int> fewer(combo.size(), 0);
+    bool beaten = false;
+    for (;;) {
+      int d = 0;
+      for (unsigned int i = 0; i < combo.size(); ++i)
+	d += combo[i] - fewer[i];
+      if (d < least) {
+	layout::guillotine own;
+	quietly([&]() {
+	    try { beaten = beaten || dropped(p, fewer, own(p, fewer)) == 0; }
+	    catch (const char *) {}
+	  });
+      }
+      unsigned int i = 0;
+      while (i < combo.size() && fewer[i] == combo[i]) fewer[i++] = 0;
+      if (i == combo.size()) break;
+      ++fewer[i];
+    }
+    check(!beaten, describe("guillotine layout drops the fewest options", seed));
+  }
+
+  Page wide(200 * 160.0 - 10, 1000);
+  for (int i = 0; i < 2; ++i) {
+    auto &art = wide.newArticle("article" + std::to_string(i) + ".art");
+    art.addOption(1, 150, 300);
+    art.addOption(2, 310, 150);
+  }
+  std::string error;
+  quietly([&]() {
+      try { layout::guillotine()(wide, {1, 1}); } catch (const char *e) { error = e; }
+    });
+  check(error == "Too many columns for the guillotine layout",
+	"guillotine layout turns down a grid of 200 columns");
+}
+
+/*
+ * Every engine, each kept from page to page as news keeps it, lays out
+ * pages of the best combination of options validly, in the caller's
+ * page, when it lays them out at all.
+ */
+void checkEngines(unsigned int count) {
+  layout::engineOptions opts;
+  opts.annealMs = 50;
+  for (auto &name : layout::engineNames()) {
+    layout::engine e = layout::makeEngine(name, opts);
+    int laidOut = 0;
+    for (unsigned int seed = 1; seed <= count; ++seed) {
+      std::mt19937 rng(seed);
+      const double height = std::uniform_real_distribution<double>(500, 1400)(rng);
+      Page p = randomPage(4 + seed % 6, seed, height);
+      quietly([&]() {
+	  try {
+	    std::vector<int> combo =
+	      p.sortArticlesBySize(p.findBestOptions(optionSolver::branchBound));
+	    check(valid(p, e(p, combo)), describe((name + " layout is valid").c_str(), seed));
+	    ++laidOut;
+	  } catch (const char *) {}
+	});
+    }
+    check(laidOut > 0, name + " lays out some pages");
+  }
+}
+
+// a layout as article positions and places, to compare between pages
+std::vector<double> placements(const Page & p,
+			       const std::list<layout::articlePlacement> & layout) {
+  std::vector<double> rtn;
+  for (auto &r : layout) {
+    rtn.push_back(&r.art_ - &*p.begin());
+    rtn.push_back(&r.opt_ - &*r.art_.begin());
+    rtn.push_back(r.area_.x_);
+    rtn.push_back(r.area_.y_);
+    rtn.push_back(r.area_.w_);
+    rtn.push_back(r.area_.h_);
+  }
+  return rtn;
+}
+
+// e's layout of p, or an empty one if it finds none
+std::vector<double> layOut(layout::engine & e, const Page & p,
+			   const std::vector<int> & combo) {
+  std::vector<double> rtn;
+  quietly([&]() {
+      try { rtn = placements(p, e(p, combo)); } catch (const char *) {}
+    });
+  return rtn;
+}
+
+/*
+ * The searches that place one article at a time find the same layout
+ * with the nogoods of earlier pages as a fresh engine does, and on
+ * three threads as on one. Each page is laid out with the next few best
+ * combinations too, as news retries them.
+ */
+void checkNogoods(unsigned int count) {
+  for (std::string name : {"worst", "worst-height", "maxrects", "skyline"}) {
+    layout::engineOptions threaded;
+    threaded.threads = 3;
+    layout::engine kept = layout::makeEngine(name);
+    layout::engine keptThreaded = layout::makeEngine(name, threaded);
+    for (unsigned int seed = 1; seed <= count; ++seed) {
+      std::mt19937 rng(seed);
+      const double height = std::uniform_real_distribution<double>(500, 1000)(rng);
+      Page p = randomPage(5 + seed % 5, seed, height);
+      std::vector<std::vector<int> > combos;
+      quietly([&]() {
+	  optionStream best(p);
+	  std::vector<int> combo;
+	  while (combos.size() < 4 && best.next(combo))
+	    combos.push_back(combo);
+	});
+      for (auto &best : combos) {
+	Page sorted = p;
+	const std::vector<int> combo = sorted.sortArticlesBySize(best);
+	layout::engine fresh = layout::makeEngine(name);
+	const std::vector<double> expected = layOut(fresh, sorted, combo);
+	check(layOut(kept, sorted, combo) == expected,
+	      describe((name + " finds the same layout with nogoods").c_str(), seed));
+	check(layOut(keptThreaded, sorted, combo) == expected,
+	      describe((name + " finds the same layout on three threads").c_str(), seed));
+      }
+    }
+  }
+}
+
+/*
+ * The engines that race searches on threads find the same layout on
+ * three threads as on one, with a time limit long enough that the
+ * annealing stops at its move limit.
+ */
+void checkThreads(unsigned int count) {
+  layout::engineOptions serial, threaded;
+  serial.annealMs = threaded.annealMs = 60000;
+  threaded.threads = 3;
+  for (std::string name : {"portfolio", "anneal"}) {
+    layout::engine one = layout::makeEngine(name, serial);
+    layout::engine three = layout::makeEngine(name, threaded);
+    for (unsigned int seed = 1; seed <= count; ++seed) {
+      std::mt19937 rng(seed);
+      const double height = std::uniform_real_distribution<double>(500, 1400)(rng);
+      Page p = randomPage(4 + seed % 6, seed, height);
+      std::vector<int> combo;
+      quietly([&]() {
+	  try {
+	    combo = p.sortArticlesBySize(p.findBestOptions(optionSolver::branchBound));
+	  } catch (const char *) {}
+	});
+      if (combo.empty()) continue;
+      check(layOut(one, p, combo) == layOut(three, p, combo),
+	    describe((name + " finds the same layout on three threads").c_str(), seed));
+    }
+  }
+}
+
+/*
+ * Every engine, portfolio too, gives the same layouts through the
+ * layout cache as without it: when the cache first meets a page, and
+ * when it gives back what it kept, for another copy of the page.
+ */
+void checkCache(unsigned int count) {
+  layout::engineOptions opts;
+  // long enough that annealing always stops after its moves, not its
+  // time, so that it lays each page out the same way every time
+  opts.annealMs = 60000;
+  for (auto &name : layout::engineNames()) {
+    layout::engine plain = layout::makeEngine(name, opts);
+    layout::engine cached = layout::cached(layout::makeEngine(name, opts),
+					   layout::engineKey(name, opts), 16, false);
+    for (unsigned int seed = 1; seed <= count; ++seed) {
+      std::mt19937 rng(seed);
+      const double height = std::uniform_real_distribution<double>(500, 1200)(rng);
+      Page p = randomPage(4 + seed % 5, seed, height);
+      std::vector<int> combo;
+      quietly([&]() {
+	  try {
+	    combo = p.sortArticlesBySize(p.findBestOptions(optionSolver::branchBound));
+	  } catch (const char *) {}
+	});
+      if (combo.empty()) continue;
+      const std::vector<double> expected = layOut(plain, p, combo);
+      check(layOut(cached, p, combo) == expected,
+	    describe((name + " lays out the same through the cache").c_str(), seed));
+      Page again = p;
+      check(layOut(cached, again, combo) == expected,
+	    describe((name + " lays out the same from the cache").c_str(), seed));
+      bool ok = expected.empty();
+      quietly([&]() {
+	  try { ok = valid(again, cached(again, combo)); } catch (const char *) {}
+	});
+      check(ok, describe((name + " layout from the cache is valid").c_str(), seed));
+    }
+  }
+}
+
+/*
+ * With a file, the cache gives back in a later run the layouts found,
+ * and the failures of a search that was exhaustive (worst), but not of
+ * one that was not (beam), which it searches again.
+ */
+void checkCacheFile(unsigned int count) {
+  const std::string layfile = "check-cache.lay";
+  for (std::string name : {"worst", "beam"}) {
+    std::remove((layfile + ".cache").c_str());
+    std::vector<Page> pages;
+    std::vector<std::vector<int> > combos;
+    for (unsigned int seed = 1; seed <= count; ++seed) {
+      std::mt19937 rng(seed);
+      const double height = std::uniform_real_distribution<double>(400, 900)(rng);
+      Page p = randomPage(5 + seed % 5, seed, height);
+      p.layfile(layfile);
+      quietly([&]() {
+	  try {
+	    combos.push_back(p.sortArticlesBySize(p.findBestOptions(optionSolver::branchBound)));
+	    pages.push_back(p);
+	  } catch (const char *) {}
+	});
+    }
+    std::vector<std::vector<double> > first;
+    unsigned long laidOut = 0;
+    {
+      layout::layoutCache run(layout::makeEngine(name), name, 16, true);
+      layout::engine e = [&](const Page & p, const std::vector<int> & combo)
+	-> const std::list<layout::articlePlacement> & { return run(p, combo); };
+      for (unsigned int i = 0; i < pages.size(); ++i) {
+	first.push_back(layOut(e, pages[i], combos[i]));
+	laidOut += !first.back().empty();
+      }
+    }
+    layout::layoutCache later(layout::makeEngine(name), name, 16, true);
+    layout::engine e = [&](const Page & p, const std::vector<int> & combo)
+      -> const std::list<layout::articlePlacement> & { return later(p, combo); };
+    bool same = true;
+    for (unsigned int i = 0; i < pages.size(); ++i)
+      same = same && layOut(e, pages[i], combos[i]) == first[i];
+    check(same, name + " lays out the same from the cache file");
+    check(laidOut < pages.size(), name + " fails on some pages of the cache file check");
+    check(later.hits() == (name == "worst" ? pages.size() : laidOut),
+	  name + (name == "worst" ? " failures are kept in the cache file"
+		  : " failures are not kept in the cache file"));
+  }
+  std::remove((layfile + ".cache").c_str());
+}
+
+/*
+ * The cache file is rewritten without repeated entries, or those no
+ * longer kept, and is held to its limit of entries, while still giving
+ * back what was last kept.
+ */
+void checkCacheFileSize() {
+  const std::string layfile = "check-size.lay";
+  {
+    std::ofstream out(layfile + ".cache");
+    for (int i = 0; i < 5000; ++i)
+      out << "page " << i << "\t!\n";
+    for (int i = 4990; i < 5000; ++i)
+      out << "page " << i << "\t!\n";
+    out << "old page\t!Some other error\n";
+  }
+  Page p = randomPage(6, 1, 700);
+  p.layfile(layfile);
+  std::vector<int> combo;
+  quietly([&]() {
+      combo = p.sortArticlesBySize(p.findBestOptions(optionSolver::branchBound));
+    });
+  std::vector<double> first;
+  {
+    layout::layoutCache run(layout::makeEngine(std::string("worst")), "worst", 16, true);
+    layout::engine e = [&](const Page & p, const std::vector<int> & combo)
+      -> const std::list<layout::articlePlacement> & { return run(p, combo); };
+    first = layOut(e, p, combo);
+  }
+  std::ifstream in(layfile + ".cache");
+  std::string line;
+  std::set<std::string> keys;
+  unsigned int lines = 0;
+  while (std::getline(in, line)) {
+    ++lines;
+    keys.insert(line.substr(0, line.find('\t')));
+  }
+  check(lines > 0 && lines <= 4096 && keys.size() == lines && !keys.count("old page"),
+	"the cache file is compacted and held to its limit");
+  layout::layoutCache later(layout::makeEngine(std::string("worst")), "worst", 16, true);
+  layout::engine e = [&](const Page & p, const std::vector<int> & combo)
+    -> const std::list<layout::articlePlacement> & { return later(p, combo); };
+  check(layOut(e, p, combo) == first && later.hits() == 1,
+	"the compacted cache file keeps the newest entry");
+  std::remove((layfile + ".cache").c_str());
+}
+
+} // namespace
+
+int main() {
+  checkSolvers(300);
+  checkMeetInMiddle();
+  checkStopped(40);
+  checkTwinLayouts();
+  checkGuillotine(200);
+  checkEngines(40);
+  checkNogoods(60);
+  checkThreads(40);
+  checkCache(30);
+  checkCacheFile(40);
+  checkCacheFileSize();
+  std::cout << checks << " checks, " << failures << " failed" << std::endl;
+  return failures ? 1 : 0;
+}
@@ -4,6 +4,7 @@
  */
 
 #include "data.hpp"
+#include <tuple>
 
 double area::size() const { return w_ * h_; }
 area::area() : 
@@ -73,6 +74,24 @@ void Article::addOption(int numCols, double width, double length) {
   //options_.emplace_back(numCols, width, length);
   //    ::std::cout << " Article option @ " << numCols << " has length " << length << " col cm " << std::endl;
 }
+int Article::removeDominatedOptions() {
+  // options are in ascending area, so anything that dominates an option
+  // comes before it.
+  std::vector<ArticleOption> front;
+  for (auto &o : options_) {
+    bool dominated = false;
+    for (auto &k : front)
+      if (!dblLt(o.layoutWidth(), k.layoutWidth()) &&
+	  !dblLt(o.layoutHeight(), k.layoutHeight())) {
+	dominated = true;
+	break;
+      }
+    if (!dominated) front.push_back(o);
+  }
+  int removed = options_.size() - front.size();
+  options_ = front;
+  return removed;
+}
 std::vector<ArticleOption>::iterator Article::begin() { return options_.begin(); }
 std::vector<ArticleOption>::const_iterator Article::begin() const { return options_.begin(); }
 std::vector<ArticleOption>::iterator Article::end() { return options_.end(); }
@@ -90,6 +109,18 @@ const ArticleOption & Article::operator[] (const int idx) const {
   return options_[idx];
 }
 int Article::id() const { return artId_; }
+bool Article::sameOptions(const Article &other) const {
+  if (options_.size() != other.options_.size()) return false;
+  typedef std::tuple<int, double, double> shape;
+  std::vector<shape> a, b;
+  for (auto &o : options_)
+    a.emplace_back(o.numCols(), o.layoutWidth(), o.layoutHeight());
+  for (auto &o : other.options_)
+    b.emplace_back(o.numCols(), o.layoutWidth(), o.layoutHeight());
+  std::sort(a.begin(), a.end());
+  std::sort(b.begin(), b.end());
+  return a == b;
+}
 
 
 
@@ -138,19 +169,18 @@ std::vector<Article>::const_iterator Page::end() const {
 
 
 Page::Page(const Page &other) :
-  width_(other.width()),
-  height_(other.height()),
-  colWidth_(other.colWidth()) {
-  for (int i=0; i < other.articles(); ++i)
-    arts_.push_back(other[i]);
-}
+  width_(other.width_),
+  height_(other.height_),
+  colWidth_(other.colWidth_),
+  arts_(other.arts_),
+  layfile_(other.layfile_) {}
 
 Page & Page::operator=(const Page &other) {
-  width_ = other.width();
-  height_ = other.height();
-  colWidth_ = other.colWidth();
-  for (int i=0; i < other.articles(); ++i)
-    arts_.push_back(other[i]);
+  width_ = other.width_;
+  height_ = other.height_;
+  colWidth_ = other.colWidth_;
+  arts_ = other.arts_;
+  layfile_ = other.layfile_;
   return *this;
 }
 
@@ -161,54 +191,25 @@ Article & Page::newArticle(const std::string & filename) {
 }
 
 
-/*
- * Returns a vector of indicies, in article order.
- * Each index is the offset within the list of options for that article.
- * eg [3,2,5] would mean the 3rd option for the first article, the 2nd for the next, and the 5th for the third.
- */
-std::vector<int> Page::findBestOptions() const {
-  const double target = width_ * height_;
-  /*
-   * For each combination: calculate the total area.
-   * Largest total area less than page area wins
-   *
-   */
-  std::vector<std::vector<int> > combinations = calcPermutations();
-  if (0) {
-    using namespace std;
-    //cout << "Combinations";
-    //cout << combinations << endl;
-  }
-  int best=-1; double bestArea = 0;
-  int i=0;
-  for (auto combo : combinations) {
-    double area = 0;
-    int j=0;
-    for (auto idx : combo) {
-      // std::cout << "arts_[" << j << "][" << idx << "] : ";
-      area += arts_[j++][idx].area();
-      // std::cout << area << std::endl;
-    }
-
-    if (area <= target && area > bestArea) {
-      // std::cout << "New best!" << std::endl;
-      bestArea = area; best = i;
-    }
-
-    ++i;
-  }
-
-  if (best < 0) {
-    throw "No solution without page overflow";
-  }
-  auto &bestCombo = combinations[best];
-
-  using namespace std;
-  cout << "Best result: area = " << bestArea << "; " << bestCombo << endl;
+std::vector<int> Page::twins() const {
+  std::vector<int> rtn(arts_.size(), -1);
+  for (unsigned int i = 0; i < arts_.size(); ++i)
+    for (int j = i - 1; j >= 0; --j)
+      if (arts_[i].sameOptions(arts_[j])) {
+	rtn[i] = j;
+	break;
+      }
+  return rtn;
+}
 
-  return bestCombo;
+int Page::removeDominatedOptions() {
+  int rtn = 0;
+  for (auto &a : arts_)
+    rtn += a.removeDominatedOptions();
+  return rtn;
 }
 
+
 /*
  * Sort arts_ such that largest artcles come first.
  * takes a parameter of a vector of the same size as arts_, and returns it modified by
@@ -240,61 +241,6 @@ std::vector<int> Page::sortArticlesBySize(std::vector<int> toRemap) {
 }
 
 
-/*
- * Algorithm: We have N articles, each with P(N) options:
- *
- * Options: (1,2,3) ; (4,5) ; (6)
- * P(N): 3,2,1
- *
- * P(N) >= 1, N and P(N) both integer.
- *
- * We start by calculating the product "prod" of P(N) for all N; this
- * is the number of results (6 is this example)
- *
- * For x in articles, divide "prod" by P(N); add "prod" of each
- * result to the output.
- *
- * article 1, "prod" becomes 6/3=2, result list is:
- * [1] [1] [2] [2] [3] [3]
- * article 2, "prod" becomes 2/2=1, result list is:
- * [1,4] [1,5] [2,4] [2,5]
- * article 3, "prod" becomes 1/1=1, result list is:
- * [1,4,6] [1,5,6] [2,4,6] [2,5,6]
- */
-std::vector<std::vector<int > >
-Page::calcPermutations() const {
-  //  std::cout << "Calculating permutations" << std::endl;
-  std::vector<std::vector<int > > rtn;
-  int prod=1;
-  for (auto a : arts_)
-    prod *= a.size();
-  for (int i=0; i < prod; ++i)
-    rtn.push_back(std::vector<int>());
-  const int totalResults = prod; // rtn.size()
-  //  std::cout << " Prepared " << prod << " results" << std::endl;
-  int num = prod;
-  for (auto a : arts_) {
-    // std::cout << "Next article: " << a.filename() << std::endl;
-    num /= a.size();
-    int i=0;
-    while (i < totalResults) {
-      int optIdx=0;
-      for (auto o : a) {
-	for (int loop =0; loop < num; ++loop) {
-	  rtn[i].push_back(optIdx);// record index into options
-	  ++i;
-	}
-	++optIdx;
-      }
-    }
-
-  }
-  // std::cout << "Pemutations done" << std::endl;
-  // std::cout << "Permutations are: " << rtn;
-  return rtn;
-}
-
-
 // for debugging: how many article options are to be considered.
 // may give a little indication of the time to be taken.
 int Page::articles() const {
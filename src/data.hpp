@@ -2,9 +2,11 @@
 #define DATA_HPP
 
 #include "debug.hpp"
+#include "layout_stop.hpp"
 #include <vector>
 #include <algorithm>
 #include <iostream>
+#include <memory>
 
 class area;
 
@@ -72,6 +74,12 @@ public:
   Article(int artId, const std::string & filename);
   ~Article();
   void addOption(int numCols, double width, double length);
+  /*
+   * Remove every option that is at least as wide and at least as tall as
+   * another option of this article, keeping only the Pareto front of
+   * (layoutWidth, layoutHeight). Returns the number removed.
+   */
+  int removeDominatedOptions();
   std::vector<ArticleOption>::iterator begin();
   std::vector<ArticleOption>::const_iterator begin() const;
   std::vector<ArticleOption>::iterator end();
@@ -81,6 +89,25 @@ public:
   ArticleOption & operator[] (const int idx);
   const ArticleOption & operator[] (const int idx) const;
   int id() const;
+  /*
+   * True if the other article has the same options (as a multiset),
+   * so that the two can be exchanged in any layout.
+   */
+  bool sameOptions(const Article &other) const;
+};
+
+
+/*
+ * Algorithms available to Page::findBestOptions.
+ * All but quantizedDP choose the same combination, differing only in
+ * speed; quantizedDP trades a little precision for time linear in the
+ * number of articles.
+ */
+enum class optionSolver {
+  exhaustive,    // evaluate every combination
+  branchBound,   // depth-first search, pruned on bounds of the remaining area
+  meetInMiddle,  // sort the sums of each half of the articles and pair them up
+  quantizedDP    // knapsack over areas rounded to a quantum
 };
 
 
@@ -123,12 +150,33 @@ public:
    */
   Article & newArticle(const std::string & filename);
 
+  /*
+   * For each article, the index of the nearest earlier article with the
+   * same options, or -1 if there is none. The option solvers need only
+   * consider one ordering of the options given to such interchangeable
+   * articles, as their areas add up the same either way.
+   */
+  std::vector<int> twins() const;
+
+  /*
+   * Article::removeDominatedOptions for every article.
+   * Returns the total number of options removed.
+   */
+  int removeDominatedOptions();
+
   /*
    * Returns a vector of indicies, in article order.
    * Each index is the offset within the list of options for that article.
    * eg [3,2,5] would mean the 3rd option for the first article, the 2nd for the next, and the 5th for the third.
+   * threads: worker threads to use where the solver supports it.
+   * quantum: for quantizedDP, areas are counted in squares of this many
+   *          scaled points (65536sp = 1pt) on a side.
+   * stop: once it stops, the solver gives the best combination it has
+   *          found so far, or failing that a greedy one.
    */
-  std::vector<int> findBestOptions() const;
+  std::vector<int> findBestOptions(optionSolver solver = optionSolver::exhaustive,
+				   int threads = 1, int quantum = 65536,
+				   const layout::stopToken &stop = layout::stopToken()) const;
 
   /*
    * Sort arts_ such that largest artcles come first.
@@ -138,12 +186,23 @@ public:
   std::vector<int> sortArticlesBySize(std::vector<int> toRemap);
 
   /*
-   * Given A = [1,2,3] [1,2,3]
-   * Produce combinations:
-   * 1,1 ; 1,2 ; 1,3 ; 2,1 ; 2,2 ; 2,3 ; 3,1 ; 3,2 ; 3,3
+   * Total area of the given combination of article options, summed in
+   * article order.
    */
-  std::vector<std::vector<int > > 
-  calcPermutations() const;
+  double area(const std::vector<int> & combo) const;
+
+  /*
+   * Number of combinations of article options (the product of
+   * Article::size() over all articles).
+   * Throws if the count does not fit in 64 bits.
+   */
+  unsigned long long combinations() const;
+
+  /*
+   * Base-10 logarithm of combinations(), summed a factor at a time, so
+   * that it never overflows.
+   */
+  double logCombinations() const;
 
   // for debugging: how many article options are to be considered.
   // may give a little indication of the time to be taken.
@@ -152,6 +211,73 @@ public:
 };
 
 
+/*
+ * Walks every combination of article options on a page without
+ * materialising them.
+ *
+ * Combinations are visited in reflected mixed-radix Gray-code order
+ * (Knuth, TAOCP 7.2.1.1, Algorithm H), so each step moves exactly one
+ * article's option index up or down by one. The total area is updated
+ * from that single change rather than re-summed, so it can drift by
+ * rounding; use Page::area() where an exact figure is needed.
+ *
+ * for (combinationCursor c(page); !c.done(); c.next())
+ *   use(*c, c.area());
+ *
+ * Passing a number of articles walks only that many leading articles;
+ * *c then holds just their options.
+ */
+class combinationCursor {
+private:
+  const Page &page_;
+  // current option index for each article
+  std::vector<int> combo_;
+  // the articles with more than one option; the first changes fastest
+  std::vector<int> digits_;
+  // +1 or -1: the direction in which each digit is moving
+  std::vector<int> dir_;
+  // focus pointers, one per digit plus a sentinel
+  std::vector<int> focus_;
+  double area_;
+  int changed_;
+  bool done_;
+public:
+  explicit combinationCursor(const Page &p, int articles = -1);
+  const std::vector<int> & operator*() const { return combo_; }
+  // running total area of the current combination
+  double area() const { return area_; }
+  // article whose option changed on the last step; -1 before the first step
+  int changed() const { return changed_; }
+  bool done() const { return done_; }
+  void next();
+};
+
+
+/*
+ * The combinations of article options that fit on a page, in descending
+ * order of total area (ties in lexicographic order), generated lazily:
+ * each call to next() does only the work needed to find one more.
+ * The first combination is the one Page::findBestOptions returns for
+ * every exact solver. Once the given stopToken stops, next() returns
+ * false.
+ */
+class optionStream {
+private:
+  class impl;
+  std::unique_ptr<impl> pImpl_;
+public:
+  explicit optionStream(const Page &p,
+			const layout::stopToken &stop = layout::stopToken());
+  ~optionStream();
+  /*
+   * Fetch the next combination into combo.
+   * Returns false once every combination that fits has been returned.
+   */
+  bool next(std::vector<int> &combo);
+  // how many combinations have been returned so far
+  int emitted() const;
+};
+
 namespace layout {
 
   /*
@@ -164,6 +290,12 @@ namespace layout {
    * preferredArticles supplies the preferred index into the article
    *   options list for each article. An earlier option in the list may
    *   be used to find a valid layout.
+   *
+   * With no layout, a routine throws "No layouts found with these
+   * article sizes." if it searched every layout it could make, so that
+   * it would fail again however long it ran, or "No layouts found,
+   * though the search was not exhaustive." if it gave up or is a
+   * heuristic; and "Layout search stopped" when its stopToken ends it.
    */
 
   /*
@@ -0,0 +1,234 @@
+/*
+ * Layout algorithm that improves a worst-fit layout by simulated
+ * annealing.
+ */
+
+#ifndef LAYOUT_ANNEAL_HPP
+#define LAYOUT_ANNEAL_HPP
+
+#include "data.hpp"
+#include "layout_free.hpp"
+#include "layout_stop.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <list>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace layout {
+
+/*
+ * algorithm to lay out a page by local search over worst-fit layouts.
+ *
+ * A layout is the order the articles are placed in, the option of each,
+ * and which way the free space is cut around each one (width-wise or
+ * height-wise first, as the two worstFit variants do). It is built by
+ * placing each article in turn into the largest free rectangle it
+ * fits; an article that fits nowhere is left off. Its cost is the area
+ * given up to options smaller than preferred, plus twice the preferred
+ * area of every article left off, so any complete layout beats any
+ * incomplete one.
+ *
+ * The search starts from worstFit's first try: page order, preferred
+ * options, cutting width-wise. Each move swaps two articles in the
+ * order, changes one article's option, or turns one cut line the other
+ * way; a move that costs d more is still taken with probability
+ * exp(-d/T), where the temperature T falls geometrically over the
+ * search.
+ *
+ * restarts independent searches, each with its own seed, run on up to
+ * threads threads; each stops after maxMoves moves or budget
+ * milliseconds, or once one with a lower seed lays out every preferred
+ * option; all stop when the stopToken given to stopWhen() asks.
+ * The best complete layout wins, ties going to the lower seed, so that
+ * within the move limit the winner does not depend on the threads.
+ */
+class annealing {
+private:
+  // one layout, as the move set sees it
+  struct state {
+    std::vector<int> order_, option_;
+    // cut width-wise first around each article
+    std::vector<char> widthFirst_;
+  };
+  // a state once built
+  struct built {
+    std::vector<area> placed_;
+    freeSpace free_;
+    double cost_;
+    int missing_;
+  };
+
+  std::list<articlePlacement> result_;
+  int restarts_, threads_;
+  unsigned long maxMoves_;
+  long budget_;
+  unsigned long attempts_;
+  stopToken stop_;
+public:
+  explicit annealing(int restarts = 4, int threads = 1, long budget = 1000,
+		     unsigned long maxMoves = 5000) :
+    restarts_(std::max(1, restarts)), threads_(std::max(1, threads)),
+    maxMoves_(maxMoves), budget_(budget), attempts_(0) {}
+
+  const std::list<articlePlacement> &
+  operator()(const Page & p, const std::vector<int> & preferredArticles) {
+    const int n = preferredArticles.size();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budget_);
+
+    state first;
+    for (int i = 0; i < n; ++i) {
+      first.order_.push_back(i);
+      first.option_.push_back(preferredArticles[i]);
+      first.widthFirst_.push_back(1);
+    }
+    std::vector<state> best(restarts_, first);
+    std::vector<double> cost(restarts_, HUGE_VAL);
+    std::vector<unsigned long> moves(restarts_, 0);
+    // the lowest restart to lay out every preferred option, or restarts_
+    std::atomic<int> solved(restarts_);
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+      for (int r = next++; r < restarts_; r = next++) {
+	if (r > solved) continue;
+	cost[r] = search(p, preferredArticles, first, r, deadline,
+			 solved, best[r], moves[r]);
+	for (int lowest = solved; cost[r] == 0 && r < lowest; )
+	  solved.compare_exchange_weak(lowest, r);
+      }
+    };
+    std::vector<std::thread> pool;
+    for (int i = 1; i < std::min(threads_, restarts_); ++i)
+      pool.emplace_back(worker);
+    worker();
+    for (auto &th : pool)
+      th.join();
+
+    attempts_ = 0;
+    int winner = 0;
+    for (int r = 0; r < restarts_; ++r) {
+      attempts_ += moves[r];
+      if (cost[r] < cost[winner]) winner = r;
+    }
+    if (cost[winner] == HUGE_VAL && stop_.stopRequested())
+      throw "Layout search stopped";
+    built b = build(p, preferredArticles, best[winner]);
+    std::cout << "Annealing tried " << attempts_ << " moves in " << restarts_
+	      << " restarts; best gives up " << b.cost_ << "pt^2" << std::endl;
+    if (b.missing_)
+      throw "No layouts found, though the search was not exhaustive.";
+    result_.clear();
+    for (int i = 0; i < n; ++i)
+      result_.emplace_back(b.placed_[i], p[i], p[i][best[winner].option_[i]]);
+    std::cout << "Unfilled space is now " << b.free_.areas() << std::endl;
+    return result_;
+  }
+
+  unsigned long attempts() const { return attempts_; }
+  void stopWhen(const stopToken & stop) { stop_ = stop; }
+private:
+  // lay out s by worst fit
+  static built build(const Page & p, const std::vector<int> & preferred,
+		     const state & s) {
+    const int n = s.order_.size();
+    built b;
+    b.placed_.assign(n, area());
+    b.cost_ = 0;
+    b.missing_ = 0;
+    freeSpace &free = b.free_;
+    free.reset(area(p.width(), p.height(), 0, 0));
+    for (int k = 0; k < n; ++k) {
+      const int i = s.order_[k];
+      const ArticleOption &opt = p[i][s.option_[i]];
+      const double w = opt.layoutWidth(), h = opt.layoutHeight();
+      int at = -1;
+      for (int r = 0; r < free.size() && at < 0; ++r)
+	if (!dblGt(w, free[r].area_.w_) && !dblGt(h, free[r].area_.h_))
+	  at = r;
+      if (at < 0) {
+	b.cost_ += 2 * p[i][preferred[i]].area();
+	++b.missing_;
+	continue;
+      }
+      b.cost_ += p[i][preferred[i]].area() - opt.area();
+      const area toSplit = free[at].area_;
+      area pieces[2];
+      int count = 0;
+      if (dblGt(toSplit.w_, w))
+	pieces[count++] = area(toSplit.w_ - w, s.widthFirst_[i] ? toSplit.h_ : h,
+			       toSplit.x_ + w, toSplit.y_);
+      if (dblGt(toSplit.h_, h))
+	pieces[count++] = area(s.widthFirst_[i] ? w : toSplit.w_, toSplit.h_ - h,
+			       toSplit.x_, toSplit.y_ + h);
+      free.divide(at, pieces, count);
+      b.placed_[i] = area(w, h, toSplit.x_, toSplit.y_);
+    }
+    return b;
+  }
+
+  /*
+   * Restart number r of the annealing, from start, seeded with r + 1;
+   * leaves its best state in best and the number of moves in moves, and
+   * returns the cost of best, or HUGE_VAL if it never laid out every
+   * article. It gives up once solved names an earlier restart.
+   */
+  double search(const Page & p, const std::vector<int> & preferred,
+		const state & start, int r,
+		std::chrono::steady_clock::time_point deadline,
+		const std::atomic<int> & solved, state & best,
+		unsigned long & moves) const {
+    const int n = start.order_.size();
+    std::mt19937 rng(r + 1);
+    std::uniform_real_distribution<double> chance(0, 1);
+    state s = start;
+    const built b = build(p, preferred, s);
+    double cost = b.cost_, bestCost = HUGE_VAL;
+    if (!b.missing_) {
+      best = s;
+      bestCost = cost;
+    }
+    // from a tenth of the page's area down to a millionth of it
+    const double hot = p.width() * p.height() / 10, cold = hot * 1e-5;
+    for (moves = 0; moves < maxMoves_ && bestCost > 0; ++moves) {
+      if (moves % 64 == 0 &&
+	  (solved < r || std::chrono::steady_clock::now() > deadline ||
+	   stop_.stopRequested()))
+	break;
+      const double t = hot * std::pow(cold / hot, double(moves) / maxMoves_);
+      state m = s;
+      const int i = rng() % n;
+      switch (rng() % 3) {
+      case 0:
+	if (n < 2) continue;
+	std::swap(m.order_[i], m.order_[(i + 1 + rng() % (n - 1)) % n]);
+	break;
+      case 1:
+	if (preferred[i] == 0) continue;
+	m.option_[i] = (m.option_[i] + 1 + rng() % preferred[i]) % (preferred[i] + 1);
+	break;
+      default:
+	m.widthFirst_[i] = !m.widthFirst_[i];
+      }
+      const built b = build(p, preferred, m);
+      if (b.cost_ <= cost || chance(rng) < std::exp((cost - b.cost_) / t)) {
+	s.order_.swap(m.order_);
+	s.option_.swap(m.option_);
+	s.widthFirst_.swap(m.widthFirst_);
+	cost = b.cost_;
+	if (!b.missing_ && cost < bestCost) {
+	  best = s;
+	  bestCost = cost;
+	}
+      }
+    }
+    return bestCost;
+  }
+};
+
+} // namespace layout
+
+#endif // ndef LAYOUT_ANNEAL_HPP
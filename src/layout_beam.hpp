@@ -0,0 +1,258 @@
+/*
+ * Layout algorithm that searches placement orders by beam search.
+ */
+
+#ifndef LAYOUT_BEAM_HPP
+#define LAYOUT_BEAM_HPP
+
+#include "data.hpp"
+#include "layout_free.hpp"
+#include "layout_stop.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <list>
+#include <thread>
+#include <vector>
+
+namespace layout {
+
+/*
+ * algorithm to lay out a page by beam search over the order in which
+ * articles are placed, and their options.
+ *
+ * Each article is placed as worstFit places it (in the largest free
+ * rectangle, splitting width-wise first), but rather than in page
+ * order, the next article is chosen: every way of placing any article
+ * not yet placed, at any option up to its preferred one, is scored,
+ * and the best width partial layouts go on to the next round, keeping
+ * only the best of those with the same options placed. Partial layouts
+ * are ranked by
+ *
+ * - the area wasted by options smaller than preferred, the least first,
+ * - then the area placed, the most first,
+ * - then fragmentation: free area outside the largest free rectangle.
+ *
+ * A partial layout is dropped once the articles left need more area
+ * than it has in free rectangles that any of them fit.
+ *
+ * Width 1 is a greedy layout; a wider beam packs better, more slowly.
+ * Of articles allowed options of the same shapes, the later is only
+ * placed after the earlier, as the two can be swapped in any layout.
+ * Rounds are expanded on up to threads threads; ties are broken by the
+ * order of the beam, so the layout does not depend on the threads.
+ * The search is abandoned when the stopToken given to stopWhen() asks.
+ */
+class beamSearch {
+private:
+  struct state {
+    freeSpace free_;
+    // option of each article, or -1 if not placed
+    std::vector<int> option_;
+    std::vector<area> placed_;
+    // area given up to smaller options so far, and area placed
+    double lost_, filled_;
+    double score_, frag_;
+  };
+  // one way of extending a beam state
+  struct move {
+    int parent_, article_, option_;
+    double score_, frag_, filled_;
+  };
+
+  std::list<articlePlacement> result_;
+  int width_, threads_;
+  unsigned long attempts_;
+  stopToken stop_;
+public:
+  explicit beamSearch(int width = 32, int threads = 1) :
+    width_(std::max(1, width)), threads_(std::max(1, threads)), attempts_(0) {}
+
+  const std::list<articlePlacement> &
+  operator()(const Page & p, const std::vector<int> & preferredArticles) {
+    const int n = preferredArticles.size();
+    const std::vector<int> twins = interchangeable(p, preferredArticles);
+    attempts_ = 0;
+
+    std::vector<state> beam(1);
+    beam[0].free_.reset(area(p.width(), p.height(), 0, 0));
+    beam[0].option_.assign(n, -1);
+    beam[0].placed_.assign(n, area());
+    beam[0].lost_ = 0;
+    beam[0].filled_ = 0;
+    beam[0].score_ = 0;
+    beam[0].frag_ = 0;
+
+    for (int depth = 0; depth < n && !beam.empty(); ++depth) {
+      // expand each state of the beam on the next free thread
+      std::vector<std::vector<move> > moves(beam.size());
+      std::atomic<unsigned int> next(0);
+      std::atomic<bool> stopped(false);
+      auto worker = [&]() {
+	for (unsigned int b = next++; b < beam.size() && !stopped; b = next++) {
+	  if (stop_.stopRequested()) stopped = true;
+	  else expand(p, preferredArticles, twins, beam, b, moves[b]);
+	}
+      };
+      const int threads = std::min<int>(threads_, beam.size());
+      std::vector<std::thread> pool;
+      for (int i = 1; i < threads; ++i)
+	pool.emplace_back(worker);
+      worker();
+      for (auto &th : pool)
+	th.join();
+      if (stopped)
+	throw "Layout search stopped";
+
+      std::vector<move> all;
+      for (auto &m : moves) {
+	attempts_ += m.size();
+	all.insert(all.end(), m.begin(), m.end());
+      }
+      // stable, so ties fall to beam order, then article, then option
+      std::stable_sort(all.begin(), all.end(), [](const move &a, const move &b) {
+	  return a.score_ < b.score_ ||
+	    (a.score_ == b.score_ && (a.filled_ > b.filled_ ||
+				      (a.filled_ == b.filled_ && a.frag_ < b.frag_)));
+	});
+      std::vector<state> nextBeam;
+      for (auto &m : all) {
+	if (int(nextBeam.size()) == width_ || m.score_ == HUGE_VAL) break;
+	nextBeam.push_back(beam[m.parent_]);
+	apply(p, preferredArticles, nextBeam.back(), m);
+	// the same options placed in another order
+	for (unsigned int k = 0; k + 1 < nextBeam.size(); ++k)
+	  if (same(nextBeam[k], nextBeam.back())) {
+	    nextBeam.pop_back();
+	    break;
+	  }
+      }
+      beam.swap(nextBeam);
+    }
+    if (beam.empty())
+      throw "No layouts found, though the search was not exhaustive.";
+
+    const state &best = beam.front();
+    result_.clear();
+    for (int i = 0; i < n; ++i)
+      result_.emplace_back(best.placed_[i], p[i], p[i][best.option_[i]]);
+    std::cout << "Unfilled space is now " << best.free_.areas() << std::endl;
+    return result_;
+  }
+
+  unsigned long attempts() const { return attempts_; }
+  void stopWhen(const stopToken & stop) { stop_ = stop; }
+private:
+  /*
+   * For each article, the nearest earlier one allowed options of the
+   * same shapes, or -1.
+   */
+  static std::vector<int> interchangeable(const Page & p, const std::vector<int> & preferred) {
+    const int n = preferred.size();
+    std::vector<int> twins(n, -1);
+    for (int i = 0; i < n; ++i)
+      for (int k = i - 1; k >= 0 && twins[i] < 0; --k) {
+	bool same = preferred[k] == preferred[i];
+	for (int j = 0; j <= preferred[i] && same; ++j)
+	  same = p[k][j].layoutWidth() == p[i][j].layoutWidth() &&
+	    p[k][j].layoutHeight() == p[i][j].layoutHeight();
+	if (same) twins[i] = k;
+      }
+    return twins;
+  }
+
+  static bool same(const state &a, const state &b) {
+    return a.option_ == b.option_;
+  }
+
+  /*
+   * The largest free rectangle an option fits, or -1.
+   * Unlike worstFit, an exact fit is allowed.
+   */
+  static int fit(const freeSpace &free, const ArticleOption &opt) {
+    for (int i = 0; i < free.size(); ++i) {
+      const area &a = free[i].area_;
+      if (!dblGt(opt.layoutWidth(), a.w_) && !dblGt(opt.layoutHeight(), a.h_))
+	return i;
+    }
+    return -1;
+  }
+
+  // split free rectangle i around opt, as worstFit does
+  static area split(freeSpace &free, int i, const ArticleOption &opt) {
+    const area toSplit = free[i].area_;
+    const double w = opt.layoutWidth(), h = opt.layoutHeight();
+    area pieces[2];
+    int n = 0;
+    if (dblGt(toSplit.w_, w))
+      pieces[n++] = area(toSplit.w_ - w, toSplit.h_, toSplit.x_ + w, toSplit.y_);
+    if (dblGt(toSplit.h_, h))
+      pieces[n++] = area(w, toSplit.h_ - h, toSplit.x_, toSplit.y_ + h);
+    free.divide(i, pieces, n);
+    return area(w, h, toSplit.x_, toSplit.y_);
+  }
+
+  // every way of placing one more article in beam[b], scored
+  void expand(const Page & p, const std::vector<int> & preferred,
+	      const std::vector<int> & twins, const std::vector<state> & beam,
+	      int b, std::vector<move> & out) const {
+    const state &s = beam[b];
+    for (unsigned int i = 0; i < preferred.size(); ++i) {
+      if (s.option_[i] >= 0) continue;
+      if (twins[i] >= 0 && s.option_[twins[i]] < 0) continue;
+      for (int j = preferred[i]; j >= 0; --j) {
+	const ArticleOption &opt = p[i][j];
+	const int at = fit(s.free_, opt);
+	if (at < 0) continue;
+	state t = s;
+	move m{b, int(i), j, 0, 0, 0};
+	apply(p, preferred, t, m);
+	m.score_ = t.score_;
+	m.frag_ = t.frag_;
+	m.filled_ = t.filled_;
+	out.push_back(m);
+      }
+    }
+  }
+
+  // place article m.article_ in s and score the result
+  static void apply(const Page & p, const std::vector<int> & preferred,
+		    state & s, const move & m) {
+    const ArticleOption &opt = p[m.article_][m.option_];
+    s.placed_[m.article_] = split(s.free_, fit(s.free_, opt), opt);
+    s.option_[m.article_] = m.option_;
+    s.lost_ += p[m.article_][preferred[m.article_]].area() - opt.area();
+    s.filled_ += opt.area();
+
+    // the narrowest and shortest of the articles left, at any option,
+    // and the least area they need
+    double minW = HUGE_VAL, minH = HUGE_VAL, need = 0;
+    for (unsigned int i = 0; i < preferred.size(); ++i) {
+      if (s.option_[i] >= 0) continue;
+      double least = HUGE_VAL;
+      for (int j = 0; j <= preferred[i]; ++j) {
+	minW = std::min(minW, p[i][j].layoutWidth());
+	minH = std::min(minH, p[i][j].layoutHeight());
+	least = std::min(least, p[i][j].area());
+      }
+      need += least;
+    }
+    // free space none of them fits is wasted
+    double waste = 0, free = 0, largest = 0;
+    for (int r = 0; r < s.free_.size(); ++r) {
+      const area &a = s.free_[r].area_;
+      const double size = s.free_[r].size_;
+      free += size;
+      largest = std::max(largest, size);
+      if (dblGt(minW, a.w_) || dblGt(minH, a.h_))
+	waste += size;
+    }
+    s.score_ = dblGt(need, free - waste) ? HUGE_VAL : s.lost_;
+    s.frag_ = free - largest;
+  }
+};
+
+} // namespace layout
+
+#endif // ndef LAYOUT_BEAM_HPP
@@ -0,0 +1,234 @@
+/*
+ * Layout algorithm that searches placements on the column grid, with
+ * the page held as bitboards.
+ */
+
+#ifndef LAYOUT_BITBOARD_HPP
+#define LAYOUT_BITBOARD_HPP
+
+#include "data.hpp"
+#include "layout_grid.hpp"
+#include "layout_stop.hpp"
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <vector>
+
+namespace layout {
+
+/*
+ * algorithm to lay out a page by searching every placement on the
+ * column grid (see pageGrid).
+ *
+ * The page is one 64-bit word per line unit, with a bit per column
+ * set where the cell is taken, so testing or filling an article's
+ * cells is an AND or OR of one mask per line, and taking it back is
+ * an XOR.
+ *
+ * The search always fills the first empty cell, top to bottom and
+ * left to right. It tries there each article not yet placed, from its
+ * preferred option down, then leaving the cell empty: the empty space
+ * runs down the column until either neighbouring column changes, so
+ * that gaps line up with the articles beside them. A branch is
+ * abandoned as soon as the space left empty, plus the smallest options
+ * of the articles still to place, would not fit on the page.
+ *
+ * Of articles allowed options of the same shapes on the grid, the
+ * later is only placed after the earlier, as the two can be swapped in
+ * any layout.
+ *
+ * The search stops with no layout after maxPlacements placements, or
+ * when the stopToken given to stopWhen() asks.
+ */
+class bitboard {
+private:
+  std::list<articlePlacement> result_;
+  double unit_;
+  unsigned long maxPlacements_;
+  unsigned long attempts_;
+  stopToken stop_;
+  bool stopped_;
+
+  pageGrid grid_;
+  std::vector<std::uint64_t> rows_;
+  std::uint64_t full_;
+  const Page *page_;
+  const std::vector<int> *preferred_;
+  // nearest earlier article with the same allowed shapes, or -1
+  std::vector<int> twins_;
+  // cells taken by each option allowed for each article
+  std::vector<std::vector<int> > widths_, heights_;
+  // placement of each article: option, column, row (option -1 if not placed)
+  std::vector<int> option_, col_, row_;
+  // cells that may still be left empty
+  long slack_;
+public:
+  explicit bitboard(double unit = 1, unsigned long maxPlacements = 1000000) :
+    unit_(unit), maxPlacements_(maxPlacements), attempts_(0), stopped_(false),
+    full_(0), page_(0), preferred_(0), slack_(0) {}
+
+  const std::list<articlePlacement> &
+  operator()(const Page & p, const std::vector<int> & preferredArticles) {
+    grid_ = pageGrid(p, unit_);
+    if (grid_.cols() > 64)
+      throw "Too many columns for the bitboard layout";
+    page_ = &p;
+    preferred_ = &preferredArticles;
+    attempts_ = 0;
+    stopped_ = false;
+    rows_.assign(grid_.rows(), 0);
+    full_ = grid_.cols() == 64 ? ~std::uint64_t(0)
+      : (std::uint64_t(1) << grid_.cols()) - 1;
+
+    const int n = preferredArticles.size();
+    widths_.assign(n, std::vector<int>());
+    heights_.assign(n, std::vector<int>());
+    option_.assign(n, -1);
+    col_.assign(n, 0);
+    row_.assign(n, 0);
+    slack_ = long(grid_.cols()) * grid_.rows();
+    for (int i = 0; i < n; ++i) {
+      long least = slack_ + 1;
+      for (int j = 0; j <= preferredArticles[i]; ++j) {
+	widths_[i].push_back(grid_.width(p[i][j]));
+	heights_[i].push_back(grid_.height(p[i][j]));
+	least = std::min(least, long(widths_[i][j]) * heights_[i][j]);
+      }
+      slack_ -= least;
+    }
+    twins_.assign(n, -1);
+    for (int i = 0; i < n; ++i)
+      for (int k = i - 1; k >= 0 && twins_[i] < 0; --k)
+	if (widths_[k] == widths_[i] && heights_[k] == heights_[i])
+	  twins_[i] = k;
+    std::cout << "Bitboard grid of " << grid_.cols() << " columns by "
+	      << grid_.rows() << " lines" << std::endl;
+    bool found = slack_ >= 0 && layoutRecurse(0, 0, n);
+    if (attempts_ >= maxPlacements_)
+      std::cout << "Bitboard search gave up after " << attempts_
+		<< " placements" << std::endl;
+    if (stopped_)
+      throw "Layout search stopped";
+    if (!found && attempts_ >= maxPlacements_)
+      throw "No layouts found, though the search was not exhaustive.";
+    if (!found)
+      throw "No layouts found with these article sizes.";
+    return result_;
+  }
+
+  unsigned long attempts() const { return attempts_; }
+  void stopWhen(const stopToken & stop) { stop_ = stop; }
+private:
+  std::uint64_t mask(int col, int width) const {
+    return (width == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << width) - 1) << col;
+  }
+
+  bool fits(int row, std::uint64_t m, int height) const {
+    if (row + height > grid_.rows()) return false;
+    for (int r = row; r < row + height; ++r)
+      if (rows_[r] & m) return false;
+    return true;
+  }
+
+  void toggle(int row, std::uint64_t m, int height) {
+    for (int r = row; r < row + height; ++r)
+      rows_[r] ^= m;
+  }
+
+  /*
+   * Place the remaining articles, filling the first empty cell at or
+   * after (row, col). Returns true once a layout is found (in result_).
+   */
+  bool layoutRecurse(int row, int col, int remaining) {
+    if (stopped_) return false;
+    if (remaining == 0) {
+      record();
+      return true;
+    }
+    // find the first empty cell
+    for (;; ++row, col = 0) {
+      if (row == grid_.rows()) return false;
+      std::uint64_t empty = col < 64 ? ~rows_[row] & full_ & (~std::uint64_t(0) << col) : 0;
+      if (empty) {
+	col = __builtin_ctzll(empty);
+	break;
+      }
+    }
+    const int n = option_.size();
+    for (int i = 0; i < n; ++i) {
+      if (option_[i] >= 0) continue;
+      if (twins_[i] >= 0 && option_[twins_[i]] < 0) continue;
+      const long least = leastCells(i);
+      for (int j = (*preferred_)[i]; j >= 0; --j) {
+	const int w = widths_[i][j], h = heights_[i][j];
+	if (col + w > grid_.cols()) continue;
+	const std::uint64_t m = mask(col, w);
+	if (!fits(row, m, h)) continue;
+	if (++attempts_ >= maxPlacements_) return false;
+	if (stop_.stopRequested()) {
+	  stopped_ = true;
+	  return false;
+	}
+	// the cells this option takes beyond the least are lost too
+	const long extra = long(w) * h - least;
+	slack_ -= extra;
+	if (slack_ >= 0) {
+	  toggle(row, m, h);
+	  option_[i] = j; col_[i] = col; row_[i] = row;
+	  bool found = layoutRecurse(row, col + w, remaining - 1);
+	  option_[i] = -1;
+	  toggle(row, m, h);
+	  if (found) {
+	    slack_ += extra;
+	    return true;
+	  }
+	}
+	slack_ += extra;
+      }
+    }
+    // leave the cell empty, down to where a neighbouring column changes
+    const std::uint64_t cell = mask(col, 1);
+    const std::uint64_t sides = (cell << 1 | cell >> 1) & full_;
+    const std::uint64_t beside = rows_[row] & sides;
+    int end = row + 1;
+    while (end < grid_.rows() && !(rows_[end] & cell) &&
+	   (rows_[end] & sides) == beside)
+      ++end;
+    if (slack_ < end - row) return false;
+    slack_ -= end - row;
+    toggle(row, cell, end - row);
+    bool found = layoutRecurse(row, col + 1, remaining);
+    toggle(row, cell, end - row);
+    slack_ += end - row;
+    return found;
+  }
+
+  long leastCells(int i) const {
+    long least = -1;
+    for (unsigned int j = 0; j < widths_[i].size(); ++j) {
+      long cells = long(widths_[i][j]) * heights_[i][j];
+      if (least < 0 || cells < least) least = cells;
+    }
+    return least;
+  }
+
+  // copy the completed layout to result_
+  void record() {
+    const Page &p = *page_;
+    result_.clear();
+    for (unsigned int i = 0; i < option_.size(); ++i) {
+      const ArticleOption &opt = p[i][option_[i]];
+      result_.emplace_back(area(opt.layoutWidth(), opt.layoutHeight(),
+				grid_.x(col_[i]), grid_.y(row_[i])),
+			   p[i], opt);
+    }
+    long empty = long(grid_.cols()) * grid_.rows();
+    for (unsigned int i = 0; i < option_.size(); ++i)
+      empty -= long(widths_[i][option_[i]]) * heights_[i][option_[i]];
+    std::cout << "Unfilled space is now " << empty << " grid cells" << std::endl;
+  }
+};
+
+} // namespace layout
+
+#endif // ndef LAYOUT_BITBOARD_HPP
@@ -0,0 +1,225 @@
+/*
+ * Memo of the layouts found, in memory and optionally on disk.
+ */
+
+#ifndef LAYOUT_CACHE_HPP
+#define LAYOUT_CACHE_HPP
+
+#include "data.hpp"
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace layout {
+
+/*
+ * Delegating layout routine that remembers what its delegate made of
+ * each page: the layout, or that there was none.
+ *
+ * A page is known by the delegate's name (with any settings that
+ * change its layouts), the page size, and the shape of every option of
+ * every article, in page order, with the option preferred for each.
+ * A layout is kept as the position on the page, option and place of
+ * each article, so it can be given back for any page with the same
+ * key. Of the delegate's errors, only that there is no layout is kept.
+ *
+ * The most recently used capacity pages are kept in memory. With disk,
+ * each new entry is also appended to a file next to the page's .lay
+ * file (the same name, ending .cache), which is read back on first use,
+ * so that a later run with the same articles skips the search.
+ * A search that was stopped proves nothing, and is not kept; one that
+ * found no layout but was not exhaustive is only kept in memory, so a
+ * later run searches again. The file keeps at most MAXSTORED entries:
+ * past that, the oldest half are dropped and the file is rewritten, as
+ * it is when it is read with entries repeated or no longer kept.
+ */
+class layoutCache {
+private:
+  // a delegate's failures worth keeping: proved, in memory and on disk
+  // ("!"), and not proved, only in memory ("?")
+  static constexpr const char *NOLAYOUT = "No layouts found with these article sizes.";
+  static constexpr const char *GAVEUP = "No layouts found, though the search was not exhaustive.";
+  static const std::size_t MAXSTORED = 4096;
+public:
+  typedef std::function<const std::list<articlePlacement> &
+			(const Page &, const std::vector<int> &)> routine;
+private:
+  routine delegate_;
+  std::string name_;
+  std::size_t capacity_;
+  bool disk_;
+  std::list<articlePlacement> result_;
+  // most recently used first
+  std::list<std::pair<std::string, std::string> > lru_;
+  std::unordered_map<std::string,
+		     std::list<std::pair<std::string, std::string> >::iterator> index_;
+  // the disk store, what is in it, and its keys, oldest first
+  std::string file_;
+  std::unordered_map<std::string, std::string> stored_;
+  std::deque<std::string> written_;
+  unsigned long hits_, misses_;
+public:
+  layoutCache(routine delegate, const std::string & name,
+	      std::size_t capacity = 256, bool disk = false) :
+    delegate_(delegate), name_(name), capacity_(capacity), disk_(disk),
+    hits_(0), misses_(0) {}
+
+  const std::list<articlePlacement> &
+  operator()(const Page & p, const std::vector<int> & preferredArticles) {
+    if (disk_ && !p.layfile().empty() && file_ != p.layfile() + ".cache")
+      load(p.layfile() + ".cache");
+    const std::string k = key(p, preferredArticles);
+    std::string value;
+    if (find(k, value)) {
+      ++hits_;
+      std::cout << "Layout cache hit (" << hits_ << " hits, " << misses_
+		<< " misses)" << std::endl;
+      return restore(p, value);
+    }
+    ++misses_;
+    try {
+      auto &result = delegate_(p, preferredArticles);
+      std::ostringstream out;
+      out.precision(17);
+      for (auto &r : result)
+	out << index(p, r.art_) << ' ' << optionIndex(r.art_, r.opt_) << ' '
+	    << r.area_.x_ << ' ' << r.area_.y_ << ' '
+	    << r.area_.w_ << ' ' << r.area_.h_ << ' ';
+      keep(k, out.str());
+      return result;
+    } catch (const char *error) {
+      if (std::string(error) == NOLAYOUT)
+	keep(k, "!");
+      else if (std::string(error) == GAVEUP)
+	remember(k, "?");
+      throw;
+    }
+  }
+
+  unsigned long hits() const { return hits_; }
+  unsigned long misses() const { return misses_; }
+private:
+  std::string key(const Page & p, const std::vector<int> & preferred) const {
+    std::ostringstream out;
+    out.precision(17);
+    out << name_ << ' ' << p.width() << ' ' << p.height();
+    for (unsigned int i = 0; i < preferred.size(); ++i) {
+      const Article &art = p[i];
+      out << " [" << (art.filename() == "RASTER" ? "R" : "") << preferred[i];
+      for (auto &opt : art)
+	out << ' ' << opt.numCols() << ' ' << opt.layoutWidth()
+	    << ' ' << opt.layoutHeight();
+      out << ']';
+    }
+    return out.str();
+  }
+
+  // position of art on p, wherever the delegate's copy of it is
+  static int index(const Page & p, const Article & art) {
+    for (auto a = p.begin(); a != p.end(); ++a)
+      if (a->id() == art.id()) return a - p.begin();
+    throw "Layout refers to an article not on the page";
+  }
+  static int optionIndex(const Article & art, const ArticleOption & opt) {
+    for (auto o = art.begin(); o != art.end(); ++o)
+      if (&*o == &opt) return o - art.begin();
+    throw "Layout refers to an option not of its article";
+  }
+
+  bool find(const std::string & k, std::string & value) {
+    auto found = index_.find(k);
+    if (found != index_.end()) {
+      lru_.splice(lru_.begin(), lru_, found->second);
+      value = found->second->second;
+      return true;
+    }
+    auto onDisk = stored_.find(k);
+    if (onDisk == stored_.end()) return false;
+    value = onDisk->second;
+    remember(k, value);
+    return true;
+  }
+
+  // put an entry at the front of the memory, forgetting the oldest
+  void remember(const std::string & k, const std::string & value) {
+    lru_.emplace_front(k, value);
+    index_[k] = lru_.begin();
+    while (lru_.size() > capacity_) {
+      index_.erase(lru_.back().first);
+      lru_.pop_back();
+    }
+  }
+
+  void keep(const std::string & k, const std::string & value) {
+    remember(k, value);
+    if (file_.empty()) return;
+    stored_[k] = value;
+    written_.push_back(k);
+    if (written_.size() > MAXSTORED) {
+      while (written_.size() > MAXSTORED / 2) {
+	stored_.erase(written_.front());
+	written_.pop_front();
+      }
+      rewrite();
+      return;
+    }
+    std::ofstream out(file_, std::ios_base::app);
+    out << k << '\t' << value << '\n';
+  }
+
+  void load(const std::string & file) {
+    file_ = file;
+    stored_.clear();
+    written_.clear();
+    std::vector<std::pair<std::string, std::string> > lines;
+    std::ifstream in(file);
+    std::string line;
+    while (std::getline(in, line)) {
+      auto tab = line.find('\t');
+      lines.emplace_back(line.substr(0, tab),
+			 tab == std::string::npos ? "" : line.substr(tab + 1));
+    }
+    // the last of each key counts; the newest MAXSTORED are kept
+    for (auto l = lines.rbegin(); l != lines.rend() && written_.size() < MAXSTORED; ++l) {
+      const std::string &value = l->second;
+      // older files kept the delegate's other errors too
+      if (value.empty() || (value[0] == '!' && value != "!")) continue;
+      if (stored_.emplace(l->first, value).second)
+	written_.push_front(l->first);
+    }
+    if (written_.size() < lines.size())
+      rewrite();
+  }
+
+  // the file as it should be: what is stored, oldest first
+  void rewrite() const {
+    std::ofstream out(file_, std::ios_base::trunc);
+    for (auto &k : written_)
+      out << k << '\t' << stored_.at(k) << '\n';
+  }
+
+  const std::list<articlePlacement> & restore(const Page & p, const std::string & value) {
+    if (value == "!")
+      throw NOLAYOUT;
+    if (value == "?")
+      throw GAVEUP;
+    std::istringstream in(value);
+    result_.clear();
+    int i, j;
+    double x, y, w, h;
+    while (in >> i >> j >> x >> y >> w >> h)
+      result_.emplace_back(area(w, h, x, y), p[i], p[i][j]);
+    return result_;
+  }
+};
+
+} // namespace layout
+
+#endif // ndef LAYOUT_CACHE_HPP
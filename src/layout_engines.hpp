@@ -0,0 +1,151 @@
+/*
+ * The layout algorithms that can be chosen by name.
+ */
+
+#ifndef LAYOUT_ENGINES_HPP
+#define LAYOUT_ENGINES_HPP
+
+#include "data.hpp"
+#include "layout_worst.hpp"
+#include "layout_maxrects.hpp"
+#include "layout_bitboard.hpp"
+#include "layout_skyline.hpp"
+#include "layout_guillotine.hpp"
+#include "layout_beam.hpp"
+#include "layout_anneal.hpp"
+#include "layout_portfolio.hpp"
+#include "layout_cache.hpp"
+#include "layout_tidy.hpp"
+#include <functional>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace layout {
+
+/*
+ * A layout routine (see the concept in data.hpp), with the edges
+ * neatened by stretchDecorator. The result stays valid until the next
+ * call.
+ */
+typedef std::function<const std::list<articlePlacement> &
+		      (const Page &, const std::vector<int> &)> engine;
+
+// settings for the engines that take any
+struct engineOptions {
+  // height of a grid cell, in points
+  double lineUnit;
+  // memo table limit of the guillotine layout, in megabytes
+  std::size_t memoryMB;
+  // partial layouts kept each round by the beam layout
+  int beamWidth;
+  // independent searches of the annealing layout, and its time limit
+  // in milliseconds
+  int restarts;
+  long annealMs;
+  // threads an engine may use
+  int threads;
+  // stops the engine's searches, eg at a deadline
+  stopToken stop;
+  engineOptions() : lineUnit(1), memoryMB(512), beamWidth(32),
+		    restarts(4), annealMs(1000), threads(1) {}
+};
+
+// wrap layout routine impl as an engine, stopped by opts.stop; the
+// engine owns a copy
+template <class T>
+engine makeEngine(T impl, const engineOptions & opts = engineOptions()) {
+  impl.stopWhen(opts.stop);
+  auto routine = std::make_shared<stretchDecorator<T> >(impl);
+  return [routine](const Page & p, const std::vector<int> & preferred)
+    -> const std::list<articlePlacement> & {
+    return (*routine)(p, preferred);
+  };
+}
+
+// optionSearch engine impl, searching on opts.threads threads
+template <class T>
+T threaded(T impl, const engineOptions & opts) {
+  impl.threads(opts.threads);
+  return impl;
+}
+
+// names accepted by makeEngine(), the default first
+inline const std::vector<std::string> & engineNames() {
+  static const std::vector<std::string> names {
+    "worst", "worst-height", "maxrects", "maxrects-area", "maxrects-contact",
+    "bitboard", "skyline", "guillotine", "beam",
+    "anneal", "portfolio"
+  };
+  return names;
+}
+
+/*
+ * Both worst fits, maxrects and skyline with the articles by area,
+ * height and width, then the other rules by area, fastest first.
+ */
+inline portfolio makePortfolio(const engineOptions & opts = engineOptions()) {
+  portfolio all(opts.threads);
+  for (auto order : {portfolio::ordering::area, portfolio::ordering::height,
+	portfolio::ordering::width}) {
+    all.add("worst", worstFit<true>(), order);
+    all.add("worst-height", worstFit<false>(), order);
+    all.add("maxrects", maxRects<fitRule::bestShortSide>(), order);
+    all.add("skyline", skyline(), order);
+  }
+  all.add("maxrects-area", maxRects<fitRule::bestArea>());
+  all.add("maxrects-contact", maxRects<fitRule::contactPoint>());
+  all.add("guillotine", guillotine(opts.memoryMB << 20));
+  all.add("beam", beamSearch(opts.beamWidth));
+  all.add("bitboard", bitboard(opts.lineUnit));
+  all.add("anneal", annealing(opts.restarts, 1, opts.annealMs));
+  return all;
+}
+
+// name with the settings that change the engine's layouts, for layoutCache
+inline std::string engineKey(const std::string & name, const engineOptions & opts) {
+  std::ostringstream key;
+  key << name << '/' << opts.lineUnit << '/' << opts.memoryMB << '/'
+      << opts.beamWidth << '/' << opts.restarts << '/' << opts.annealMs;
+  return key.str();
+}
+
+// engine e, remembering its layouts (see layoutCache)
+inline engine cached(engine e, const std::string & key, std::size_t capacity,
+		     bool disk) {
+  auto cache = std::make_shared<layoutCache>(e, key, capacity, disk);
+  return [cache](const Page & p, const std::vector<int> & preferred)
+    -> const std::list<articlePlacement> & {
+    return (*cache)(p, preferred);
+  };
+}
+
+inline engine makeEngine(const std::string & name,
+			 const engineOptions & opts = engineOptions()) {
+  if (name == "worst")
+    return makeEngine(threaded(worstFit<true>(), opts), opts);
+  if (name == "worst-height")
+    return makeEngine(threaded(worstFit<false>(), opts), opts);
+  if (name == "maxrects")
+    return makeEngine(threaded(maxRects<fitRule::bestShortSide>(), opts), opts);
+  if (name == "maxrects-area")
+    return makeEngine(threaded(maxRects<fitRule::bestArea>(), opts), opts);
+  if (name == "maxrects-contact")
+    return makeEngine(threaded(maxRects<fitRule::contactPoint>(), opts), opts);
+  if (name == "bitboard") return makeEngine(bitboard(opts.lineUnit), opts);
+  if (name == "skyline") return makeEngine(threaded(skyline(), opts), opts);
+  if (name == "guillotine")
+    return makeEngine(guillotine(opts.memoryMB << 20), opts);
+  if (name == "beam")
+    return makeEngine(beamSearch(opts.beamWidth, opts.threads), opts);
+  if (name == "anneal")
+    return makeEngine(annealing(opts.restarts, opts.threads, opts.annealMs), opts);
+  if (name == "portfolio") return makeEngine(makePortfolio(opts), opts);
+  throw "Unknown layout algorithm";
+}
+
+} // namespace layout
+
+#endif // ndef LAYOUT_ENGINES_HPP
@@ -0,0 +1,87 @@
+/*
+ * Cheap tests that rule out combinations of article options before a
+ * layout algorithm spends any time on them.
+ */
+
+#ifndef LAYOUT_FILTER_HPP
+#define LAYOUT_FILTER_HPP
+
+#include "data.hpp"
+#include <ostream>
+#include <vector>
+
+namespace layout {
+
+/*
+ * Necessary conditions for a combination of article options to fit on
+ * a page in any rectangular layout, each checked in one pass:
+ *
+ * oversize: no option may be wider or taller than the page.
+ * band:     an article taller than half the page crosses the page's
+ *           horizontal centre line wherever it is placed, so the widths
+ *           (ie columns) of all such articles must fit across the page.
+ * stack:    likewise an article wider than half the page crosses the
+ *           vertical centre line, so the heights of all such articles
+ *           must fit down the page.
+ *
+ * Counts how many combinations (or prefixes) each rule rejected.
+ */
+class feasibilityFilter {
+private:
+  unsigned long tested_, oversize_, band_, stack_;
+public:
+  feasibilityFilter() :
+    tested_(0), oversize_(0), band_(0), stack_(0) {}
+
+  /*
+   * Test the options of the first count articles (all if count < 0).
+   * As every rule only gets harder to pass as articles are added, a
+   * failing prefix rules out every combination that starts with it.
+   */
+  bool operator()(const Page & p, const std::vector<int> & options, int count = -1) {
+    ++tested_;
+    const double width = p.width(), height = p.height();
+    double bandWidth = 0, stackHeight = 0;
+    if (count < 0) count = options.size();
+    for (int i = 0; i < count; ++i) {
+      auto &opt = p[i][options[i]];
+      const double w = opt.layoutWidth(), h = opt.layoutHeight();
+      if (dblGt(w, width) || dblGt(h, height)) {
+	++oversize_;
+	return false;
+      }
+      if (2 * h > height) bandWidth += w;
+      if (2 * w > width) stackHeight += h;
+    }
+    if (dblGt(bandWidth, width)) {
+      ++band_;
+      return false;
+    }
+    if (dblGt(stackHeight, height)) {
+      ++stack_;
+      return false;
+    }
+    return true;
+  }
+
+  unsigned long rejected() const { return oversize_ + band_ + stack_; }
+  // add the counts of another filter, eg one used by another thread
+  feasibilityFilter & operator+=(const feasibilityFilter & other) {
+    tested_ += other.tested_;
+    oversize_ += other.oversize_;
+    band_ += other.band_;
+    stack_ += other.stack_;
+    return *this;
+  }
+
+  void report(std::ostream &out) const {
+    out << "Feasibility filter rejected " << rejected() << " of " << tested_
+	<< " tests (oversize " << oversize_
+	<< ", band " << band_
+	<< ", stack " << stack_ << ')' << std::endl;
+  }
+};
+
+} // namespace layout
+
+#endif // ndef LAYOUT_FILTER_HPP
@@ -0,0 +1,135 @@
+/*
+ * Contiguous store of free rectangles for the layout algorithms.
+ */
+
+#ifndef LAYOUT_FREE_HPP
+#define LAYOUT_FREE_HPP
+
+#include "data.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace layout {
+
+/*
+ * Disjoint free rectangles, held in one vector sorted by area, largest
+ * first, so the largest rectangle an article fits is found by scanning
+ * from the front and stopping at the first fit, or as soon as the
+ * rectangles get smaller than the article.
+ *
+ * Rectangles of equal area are ordered as a list split in place would
+ * hold them, with the pieces of a split rectangle taking its position.
+ * Each rectangle carries its path of splits from the page as a bit
+ * string (piece 0 or 1 at each two-way split), and list order is the
+ * lexicographic order of those paths. Paths deeper than 64 two-way
+ * splits share their last bit, which only matters to ties.
+ *
+ * Splits are undone in reverse order by restore().
+ */
+class freeSpace {
+public:
+  struct rect {
+    area area_;
+    double size_;
+    // split path, most significant bit first
+    std::uint64_t path_;
+    int depth_;
+  };
+private:
+  std::vector<rect> rects_;
+
+  static bool before(const rect &a, const rect &b) {
+    if (a.size_ != b.size_) return a.size_ > b.size_;
+    return a.path_ < b.path_;
+  }
+
+  void insert(const rect &r) {
+    rects_.insert(std::upper_bound(rects_.begin(), rects_.end(), r, before), r);
+  }
+  void erase(const rect &r) {
+    auto i = std::lower_bound(rects_.begin(), rects_.end(), r, before);
+    // only past the path depth can equal keys hold different rectangles
+    while (i->area_.x_ != r.area_.x_ || i->area_.y_ != r.area_.y_) ++i;
+    rects_.erase(i);
+  }
+public:
+  // the pieces a rectangle was split into, for restore()
+  struct split {
+    rect whole_;
+    rect pieces_[2];
+    int count_;
+  };
+
+  void reset(const area &page) {
+    rects_.assign(1, rect{page, page.size(), 0, 0});
+  }
+
+  /*
+   * The rectangle with the most space left over by an article of w x h
+   * and the given size, ie the largest it fits, or -1 if none has any
+   * space left over. Of equal rectangles, the first in list order.
+   */
+  int worst(double w, double h, double size) const {
+    for (unsigned int i = 0; i < rects_.size(); ++i) {
+      const rect &r = rects_[i];
+      if (!(r.size_ - size > 0)) break;
+      if (r.area_.w_ < w) continue;
+      if (r.area_.h_ < h) continue;
+      return i;
+    }
+    return -1;
+  }
+
+  const rect & operator[](int i) const { return rects_[i]; }
+  int size() const { return rects_.size(); }
+
+  /*
+   * Replace rectangle i by up to two pieces, the first of which comes
+   * first in list order. Returns what restore() needs to undo it.
+   */
+  split divide(int i, const area *pieces, int count) {
+    split s;
+    s.whole_ = rects_[i];
+    s.count_ = count;
+    const rect &w = s.whole_;
+    for (int k = 0; k < count; ++k) {
+      rect &r = s.pieces_[k];
+      r.area_ = pieces[k];
+      r.size_ = pieces[k].size();
+      r.path_ = w.path_;
+      r.depth_ = w.depth_;
+      if (count == 2 && w.depth_ < 64) {
+	r.depth_ = w.depth_ + 1;
+	if (k == 1) r.path_ |= std::uint64_t(1) << (64 - r.depth_);
+      }
+    }
+    rects_.erase(rects_.begin() + i);
+    for (int k = 0; k < count; ++k)
+      insert(s.pieces_[k]);
+    return s;
+  }
+
+  // undo divide()
+  void restore(const split &s) {
+    for (int k = 0; k < s.count_; ++k)
+      erase(s.pieces_[k]);
+    insert(s.whole_);
+  }
+
+  // the free rectangles, in list order
+  std::vector<area> areas() const {
+    std::vector<rect> byPath(rects_);
+    std::stable_sort(byPath.begin(), byPath.end(), [](const rect &a, const rect &b) {
+	return a.path_ < b.path_;
+      });
+    std::vector<area> result;
+    for (auto &r : byPath)
+      result.push_back(r.area_);
+    return result;
+  }
+};
+
+} // namespace layout
+
+#endif // ndef LAYOUT_FREE_HPP
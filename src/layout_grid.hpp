@@ -0,0 +1,76 @@
+/*
+ * The column grid of a page, for layout algorithms that work in whole
+ * columns and lines rather than points.
+ */
+
+#ifndef LAYOUT_GRID_HPP
+#define LAYOUT_GRID_HPP
+
+#include "data.hpp"
+#include <cmath>
+
+namespace layout {
+
+/*
+ * Divides a page into cells one column wide and one line unit high.
+ *
+ * The column pitch (column plus gutter) and gutter are not supplied,
+ * so are worked out from the article options: an option of c columns
+ * is c pitches wide, less one gutter. With no article set at two
+ * widths, the gutter is taken as 0.
+ *
+ * Articles take whole cells: a width is rounded up to whole columns
+ * (which only matters to RASTER articles) and a height to whole line
+ * units, so on a coarse unit some layouts that would just fit are lost.
+ */
+class pageGrid {
+private:
+  double unit_, pitch_, gutter_;
+  int cols_, rows_;
+  // allow for rounding in the sizes LaTeX reports
+  static constexpr double EPS = 0.001;
+public:
+  pageGrid() : unit_(1), pitch_(1), gutter_(0), cols_(0), rows_(0) {}
+
+  pageGrid(const Page & p, double unit) :
+    unit_(unit), pitch_(0), gutter_(0), cols_(0), rows_(0) {
+    for (auto &art : p) {
+      if (art.size() < 2 || art.filename() == "RASTER") continue;
+      const ArticleOption &a = art[0], &b = art[art.size()-1];
+      if (a.numCols() == b.numCols()) continue;
+      pitch_ = (b.layoutWidth() - a.layoutWidth()) / (b.numCols() - a.numCols());
+      gutter_ = a.numCols() * pitch_ - a.layoutWidth();
+      break;
+    }
+    if (pitch_ <= 0) {
+      for (auto &art : p)
+	if (art.size() > 0 && art.filename() != "RASTER")
+	  pitch_ = art[0].layoutWidth() / art[0].numCols();
+      gutter_ = 0;
+    }
+    if (pitch_ <= 0)
+      pitch_ = p.width(); // nothing but pictures: one wide column
+    cols_ = std::floor((p.width() + gutter_) / pitch_ + EPS);
+    rows_ = std::floor(p.height() / unit_ + EPS);
+  }
+
+  int cols() const { return cols_; }
+  int rows() const { return rows_; }
+  double unit() const { return unit_; }
+
+  // cells taken by an option
+  int width(const ArticleOption & o) const {
+    return std::max(1.0, std::ceil((o.layoutWidth() + gutter_) / pitch_ - EPS));
+  }
+  int height(const ArticleOption & o) const {
+    return std::max(1.0, std::ceil(o.layoutHeight() / unit_ - EPS));
+  }
+
+  // position of a cell on the page
+  double x(int col) const { return col * pitch_; }
+  double y(int row) const { return row * unit_; }
+};
+
+} // namespace layout
+
+#endif // ndef LAYOUT_GRID_HPP
@@ -0,0 +1,328 @@
+/*
+ * Exact layout algorithm for pages of few articles, over every layout
+ * made by guillotine cuts.
+ */
+
+#ifndef LAYOUT_GUILLOTINE_HPP
+#define LAYOUT_GUILLOTINE_HPP
+
+#include "data.hpp"
+#include "layout_grid.hpp"
+#include "layout_stop.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace layout {
+
+/*
+ * algorithm to lay out a page by the best guillotine cut, ie a layout
+ * that can be cut apart by straight cuts right across what remains,
+ * which are the layouts a newspaper reader can follow most easily.
+ *
+ * The least height needed to lay out a set of articles across a width
+ * of whole columns (see pageGrid) is found by recursion over the last
+ * cut: across (the two sets stacked, heights added) or down (side by
+ * side at every dividing column, the taller side counting). Results are
+ * memoised in a hash table keyed on (width, set of articles), so the
+ * heights stay exact sums of the article heights, with no need to
+ * quantise them.
+ *
+ * The preferred options are tried on their own first; only if they
+ * cannot be laid out are smaller options allowed, counting each step
+ * down the options of an article as one option dropped. The memo also
+ * keys on the most options a set may drop between its articles, and
+ * the page is tried with at most 1, 2, ... dropped in all, so the
+ * layout found drops the fewest options it can, the height only
+ * breaking ties. A page that still does not fit with every option
+ * allowed is proved to have no guillotine layout with those options or
+ * any smaller: that is reported and remembered, so that a later call
+ * with no larger options fails at once.
+ *
+ * The table is limited to memoryCap bytes (roughly); a search that
+ * outgrows it gives up, proving nothing, as does a search stopped by
+ * the stopToken given to stopWhen(). Up to 24 articles, on a grid of
+ * up to 127 columns.
+ */
+class guillotine {
+public:
+  static const int MAXARTICLES = 24;
+  static const int MAXCOLS = 127;
+private:
+  std::list<articlePlacement> result_;
+  std::size_t memoryCap_;
+  unsigned long attempts_;
+
+  // how the least height of a memo entry was reached
+  struct cut {
+    double height_;
+    // the articles above or to the left of the cut, or for a single
+    // article, its option
+    std::uint32_t first_;
+    // options the first part drops at most; the other part, the rest
+    std::uint16_t drops_;
+    // width of the left part, or 0 for a cut across; -1 for one article
+    std::int8_t cols_;
+  };
+  std::unordered_map<std::uint64_t, cut> memo_;
+  // the search gave up: out of memory, or stopped
+  bool overflow_;
+  stopToken stop_;
+  bool stopped_;
+
+  pageGrid grid_;
+  const Page *page_;
+  const std::vector<int> *preferred_;
+  // for each article, options it may drop, and width in columns: the
+  // least height and the least area of its allowed options that fit
+  std::vector<std::vector<std::vector<double> > > minHeight_, minArea_;
+
+  // options by article id of calls proved to have no layout
+  struct proof {
+    double width_, height_;
+    std::vector<int> options_;
+  };
+  std::vector<proof> infeasible_;
+
+  // the memo's own overhead for an entry
+  static const std::size_t NODE = sizeof(std::uint64_t) + sizeof(cut) + 4 * sizeof(void*);
+public:
+  explicit guillotine(std::size_t memoryCap = std::size_t(512) << 20) :
+    memoryCap_(memoryCap), attempts_(0), overflow_(false), stopped_(false),
+    page_(0), preferred_(0) {}
+
+  const std::list<articlePlacement> &
+  operator()(const Page & p, const std::vector<int> & preferredArticles) {
+    const int n = preferredArticles.size();
+    if (n > MAXARTICLES)
+      throw "Too many articles for the guillotine layout";
+    grid_ = pageGrid(p, 1);
+    if (grid_.cols() > MAXCOLS)
+      throw "Too many columns for the guillotine layout";
+    page_ = &p;
+    preferred_ = &preferredArticles;
+    attempts_ = 0;
+    stopped_ = false;
+
+    std::vector<int> byId = optionsById(p, preferredArticles);
+    if (provedBefore(p, byId)) {
+      std::cout << "Guillotine layout already proved impossible"
+		<< " for these options" << std::endl;
+      throw "No layouts found with these article sizes.";
+    }
+
+    const std::uint32_t all = (1u << n) - 1;
+    const int most = drops(all);
+    if (most > 0xffff)
+      throw "Too many options for the guillotine layout";
+    bounds(n);
+    memo_.clear();
+    overflow_ = false;
+    // every option allowed first, which is quick, to prove there is no
+    // layout at all
+    double height = least(grid_.cols(), all, most);
+    checkGaveUp();
+    if (dblGt(height, p.height())) {
+      infeasible_.push_back(proof{p.width(), p.height(), byId});
+      std::cout << "Guillotine layout proved impossible for these options"
+		<< " after " << attempts_ << " cuts" << std::endl;
+      throw "No layouts found with these article sizes.";
+    }
+    // then the preferred options alone, and more and more dropped
+    int dropped = 0;
+    for (; dropped < most; ++dropped) {
+      height = least(grid_.cols(), all, dropped);
+      checkGaveUp();
+      if (!dblGt(height, p.height())) break;
+    }
+    height = least(grid_.cols(), all, dropped);
+    result_.clear();
+    build(grid_.cols(), all, dropped, 0, 0);
+    std::cout << "Guillotine layout";
+    if (dropped)
+      std::cout << " dropping " << dropped << " option(s)";
+    std::cout << " leaves " << p.height() - height
+	      << "pt at the foot of the page after " << attempts_
+	      << " cuts" << std::endl;
+    return result_;
+  }
+
+  unsigned long attempts() const { return attempts_; }
+  void stopWhen(const stopToken & stop) { stop_ = stop; }
+private:
+  // the options, indexed by article id rather than page order
+  static std::vector<int> optionsById(const Page & p, const std::vector<int> & options) {
+    std::vector<int> byId;
+    for (unsigned int i = 0; i < options.size(); ++i) {
+      const int id = p[i].id();
+      if (int(byId.size()) <= id) byId.resize(id + 1, -1);
+      byId[id] = options[i];
+    }
+    return byId;
+  }
+
+  // was a page with no smaller options already proved impossible?
+  bool provedBefore(const Page & p, const std::vector<int> & byId) const {
+    for (auto &f : infeasible_) {
+      if (f.width_ != p.width() || f.height_ != p.height()) continue;
+      if (f.options_.size() != byId.size()) continue;
+      bool within = true;
+      for (unsigned int i = 0; i < byId.size() && within; ++i)
+	within = byId[i] <= f.options_[i];
+      if (within) return true;
+    }
+    return false;
+  }
+
+  void bounds(int n) {
+    const int cols = grid_.cols();
+    minHeight_.assign(n, std::vector<std::vector<double> >());
+    minArea_.assign(n, std::vector<std::vector<double> >());
+    for (int i = 0; i < n; ++i) {
+      std::vector<double> height(cols + 1, HUGE_VAL), area(cols + 1, HUGE_VAL);
+      for (int j = (*preferred_)[i]; j >= 0; --j) {
+	const ArticleOption &opt = (*page_)[i][j];
+	for (int c = grid_.width(opt); c <= cols; ++c) {
+	  height[c] = std::min(height[c], opt.layoutHeight());
+	  area[c] = std::min(area[c], opt.area());
+	}
+	minHeight_[i].push_back(height);
+	minArea_[i].push_back(area);
+      }
+    }
+  }
+
+  /*
+   * A height that laying out set across cols columns, dropping at most
+   * dropped options, cannot beat: its tallest article, or its area
+   * spread across the columns.
+   */
+  double lowerBound(int cols, std::uint32_t set, int dropped) const {
+    double tallest = 0, area = 0;
+    for (std::uint32_t s = set; s; s &= s - 1) {
+      const int i = __builtin_ctz(s);
+      const int d = std::min(dropped, (*preferred_)[i]);
+      tallest = std::max(tallest, minHeight_[i][d][cols]);
+      area += minArea_[i][d][cols];
+    }
+    return std::max(tallest, area / grid_.x(cols));
+  }
+
+  // throw if the last search was stopped or outgrew the memo
+  void checkGaveUp() const {
+    if (stopped_)
+      throw "Layout search stopped";
+    if (overflow_) {
+      std::cout << "Guillotine layout gave up at its memory limit after "
+		<< attempts_ << " cuts" << std::endl;
+      throw "No layouts found, though the search was not exhaustive.";
+    }
+  }
+
+  // options the articles in set can drop between them
+  int drops(std::uint32_t set) const {
+    int total = 0;
+    for (std::uint32_t s = set; s; s &= s - 1)
+      total += (*preferred_)[__builtin_ctz(s)];
+    return total;
+  }
+
+  static std::uint64_t key(int cols, std::uint32_t set, int dropped) {
+    return std::uint64_t(set) << 24 | std::uint64_t(dropped) << 8 | cols;
+  }
+
+  /*
+   * least height to lay out the articles in set across cols columns,
+   * dropping at most dropped options (no more than drops(set))
+   */
+  double least(int cols, std::uint32_t set, int dropped) {
+    const std::uint64_t k = key(cols, set, dropped);
+    auto found = memo_.find(k);
+    if (found != memo_.end())
+      return found->second.height_;
+    if (overflow_) return HUGE_VAL;
+    if (stop_.stopRequested()) {
+      overflow_ = stopped_ = true;
+      return HUGE_VAL;
+    }
+    ++attempts_;
+
+    cut best{HUGE_VAL, 0, 0, -1};
+    const std::uint32_t low = set & -set;
+    if (set == low) {
+      // one article: its shortest allowed option that is narrow enough
+      const int i = __builtin_ctz(set);
+      for (int j = (*preferred_)[i]; j >= (*preferred_)[i] - dropped; --j) {
+	const ArticleOption &opt = (*page_)[i][j];
+	if (grid_.width(opt) <= cols && opt.layoutHeight() < best.height_) {
+	  best.height_ = opt.layoutHeight();
+	  best.first_ = j;
+	}
+      }
+    } else {
+      // each split of the set once: the first part holds its lowest article
+      const std::uint32_t rest = set ^ low;
+      for (std::uint32_t sub = rest; ; sub = (sub - 1) & rest) {
+	const std::uint32_t first = sub | low, second = set ^ first;
+	// every share of the options dropped that both parts can use
+	const int from = std::max(0, dropped - drops(second));
+	const int to = std::min(dropped, drops(first));
+	// (bounds only skip work: every memo entry stays exact)
+	for (int d = from; d <= to && second; ++d) {
+	  const double rest = lowerBound(cols, second, dropped - d);
+	  if (lowerBound(cols, first, d) + rest >= best.height_) continue;
+	  double a = least(cols, first, d);
+	  if (a + rest >= best.height_) continue;
+	  double h = a + least(cols, second, dropped - d);
+	  if (h < best.height_) best = cut{h, first, std::uint16_t(d), 0};
+	}
+	for (int c = 1; c < cols && second; ++c) {
+	  if (lowerBound(c, first, to) >= best.height_ ||
+	      lowerBound(cols - c, second, dropped - from) >= best.height_) continue;
+	  for (int d = from; d <= to; ++d) {
+	    if (lowerBound(c, first, d) >= best.height_ ||
+		lowerBound(cols - c, second, dropped - d) >= best.height_) continue;
+	    double a = least(c, first, d);
+	    if (a >= best.height_) continue;
+	    double h = std::max(a, least(cols - c, second, dropped - d));
+	    if (h < best.height_) best = cut{h, first, std::uint16_t(d), std::int8_t(c)};
+	  }
+	}
+	if (sub == 0) break;
+      }
+    }
+    if ((memo_.size() + 1) * NODE > memoryCap_) {
+      overflow_ = true;
+      return HUGE_VAL;
+    }
+    memo_.emplace(k, best);
+    return best.height_;
+  }
+
+  // place the articles in set as the memo says, from (col, y)
+  void build(int cols, std::uint32_t set, int dropped, int col, double y) {
+    const cut &c = memo_.at(key(cols, set, dropped));
+    if (c.cols_ < 0) {
+      const int i = __builtin_ctz(set);
+      const Article &art = (*page_)[i];
+      const ArticleOption &opt = art[c.first_];
+      result_.emplace_back(area(opt.layoutWidth(), opt.layoutHeight(),
+				grid_.x(col), y), art, opt);
+    } else if (c.cols_ == 0) {
+      build(cols, c.first_, c.drops_, col, y);
+      build(cols, set ^ c.first_, dropped - c.drops_, col,
+	    y + memo_.at(key(cols, c.first_, c.drops_)).height_);
+    } else {
+      build(c.cols_, c.first_, c.drops_, col, y);
+      build(cols - c.cols_, set ^ c.first_, dropped - c.drops_, col + c.cols_, y);
+    }
+  }
+};
+
+} // namespace layout
+
+#endif // ndef LAYOUT_GUILLOTINE_HPP
@@ -0,0 +1,180 @@
+/*
+ * Template for the maximal-rectangles layout algorithm.
+ */
+
+#ifndef LAYOUT_MAXRECTS_HPP
+#define LAYOUT_MAXRECTS_HPP
+
+#include "data.hpp"
+#include "layout_search.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace layout {
+
+/*
+ * How maxRects chooses where to put an article, among the free
+ * rectangles it fits (always at the top left of the rectangle):
+ *
+ * bestShortSide: the least space left on the shorter side, then on
+ *                the longer side
+ * bestArea:      the smallest rectangle, then as bestShortSide
+ * contactPoint:  the most edge length touching the sides of the page
+ *                or articles already placed
+ */
+enum class fitRule { bestShortSide, bestArea, contactPoint };
+
+/*
+ * algorithm to lay out a page by maximal rectangles.
+ *
+ * Free space is held as every maximal empty rectangle on the page.
+ * Unlike worstFit's split pieces these overlap, so no space is lost to
+ * an unlucky cut: each placement trims every free rectangle it
+ * overlaps into up to four maximal pieces, and drops any rectangle
+ * left inside another.
+ *
+ * Ties go to the earliest free rectangle, so layouts are reproducible.
+ * Smaller options are tried as described in optionSearch; the free
+ * rectangles before each placement are kept to backtrack to.
+ */
+template <fitRule rule = fitRule::bestShortSide>
+class maxRects : public optionSearch<maxRects<rule> > {
+private:
+  friend class optionSearch<maxRects<rule> >;
+  std::vector<area> free_;
+  // free_ before each placement; kept allocated between searches
+  std::vector<std::vector<area> > saved_;
+  std::vector<area> placed_;
+  double width_, height_;
+
+  static bool same(double a, double b) { return !dblGt(a, b) && !dblGt(b, a); }
+
+  void start(const Page & p) {
+    width_ = p.width();
+    height_ = p.height();
+    free_.assign(1, area(width_, height_, 0, 0));
+    placed_.clear();
+  }
+
+  /*
+   * Score a w x h article at the top left of free rectangle f;
+   * lower is better.
+   */
+  void score(const area &f, double w, double h,
+	     double &primary, double &secondary) const {
+    const double dw = f.w_ - w, dh = f.h_ - h;
+    switch (rule) {
+    case fitRule::bestShortSide:
+      primary = std::min(dw, dh);
+      secondary = std::max(dw, dh);
+      break;
+    case fitRule::bestArea:
+      primary = f.size() - w * h;
+      secondary = std::min(dw, dh);
+      break;
+    case fitRule::contactPoint:
+      primary = -contact(area(w, h, f.x_, f.y_));
+      secondary = 0;
+      break;
+    }
+  }
+
+  // length of the edges of a that touch the page sides or placed articles
+  double contact(const area &a) const {
+    double length = 0;
+    if (same(a.x_, 0) || same(a.x2(), width_)) length += a.h_;
+    if (same(a.y_, 0) || same(a.y2(), height_)) length += a.w_;
+    for (auto &q : placed_) {
+      if (same(q.x2(), a.x_) || same(q.x_, a.x2()))
+	length += std::max(0.0, std::min(q.y2(), a.y2()) - std::max(q.y_, a.y_));
+      if (same(q.y2(), a.y_) || same(q.y_, a.y2()))
+	length += std::max(0.0, std::min(q.x2(), a.x2()) - std::max(q.x_, a.x_));
+    }
+    return length;
+  }
+
+  /*
+   * Place one article into the best free rectangle by rule, and trim
+   * the free rectangles around it.
+   * Returns false, changing nothing, if the article fits nowhere.
+   */
+  bool place(const ArticleOption &opt) {
+    const double w = opt.layoutWidth(), h = opt.layoutHeight();
+    int best = -1;
+    double bestPrimary = 0, bestSecondary = 0;
+    for (unsigned int i = 0; i < free_.size(); ++i) {
+      const area &f = free_[i];
+      if (dblGt(w, f.w_) || dblGt(h, f.h_)) continue;
+      double primary, secondary;
+      score(f, w, h, primary, secondary);
+      if (best < 0 || primary < bestPrimary ||
+	  (primary == bestPrimary && secondary < bestSecondary)) {
+	best = i;
+	bestPrimary = primary;
+	bestSecondary = secondary;
+      }
+    }
+    if (best < 0)
+      return false;
+
+    const area used(w, h, free_[best].x_, free_[best].y_);
+    if (saved_.size() <= placed_.size())
+      saved_.resize(placed_.size() + 1);
+    saved_[placed_.size()].swap(free_);
+    trim(saved_[placed_.size()], used);
+    placed_.push_back(used);
+    return true;
+  }
+
+  // free_ = the maximal rectangles of before, less used
+  void trim(const std::vector<area> &before, const area &used) {
+    free_.clear();
+    for (auto &f : before) {
+      if (!dblGt(used.x2(), f.x_) || !dblGt(f.x2(), used.x_) ||
+	  !dblGt(used.y2(), f.y_) || !dblGt(f.y2(), used.y_)) {
+	free_.push_back(f);
+	continue;
+      }
+      // |---f---|
+      // | |u| . |  up to four overlapping pieces: left, right, above, below
+      // |-------|
+      if (dblGt(used.x_, f.x_))
+	free_.emplace_back(used.x_ - f.x_, f.h_, f.x_, f.y_);
+      if (dblGt(f.x2(), used.x2()))
+	free_.emplace_back(f.x2() - used.x2(), f.h_, used.x2(), f.y_);
+      if (dblGt(used.y_, f.y_))
+	free_.emplace_back(f.w_, used.y_ - f.y_, f.x_, f.y_);
+      if (dblGt(f.y2(), used.y2()))
+	free_.emplace_back(f.w_, f.y2() - used.y2(), f.x_, used.y2());
+    }
+    // drop rectangles inside others (the later of two equal ones)
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < free_.size(); ++i) {
+      bool inside = false;
+      for (unsigned int j = 0; j < free_.size() && !inside; ++j)
+	inside = j != i && contains(free_[j], free_[i]) &&
+	  (j < i || !contains(free_[i], free_[j]));
+      if (!inside)
+	free_[kept++] = free_[i];
+    }
+    free_.resize(kept, area());
+  }
+
+  static bool contains(const area &a, const area &b) {
+    return !dblGt(a.x_, b.x_) && !dblGt(a.y_, b.y_) &&
+      !dblGt(b.x2(), a.x2()) && !dblGt(b.y2(), a.y2());
+  }
+
+  // take back the last place()
+  void unplace() {
+    placed_.pop_back();
+    free_.swap(saved_[placed_.size()]);
+  }
+
+  const std::vector<area> & placed() const { return placed_; }
+  std::vector<area> unfilled() const { return free_; }
+};
+
+} // namespace layout
+
+#endif // ndef LAYOUT_MAXRECTS_HPP
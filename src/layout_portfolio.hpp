@@ -0,0 +1,200 @@
+/*
+ * Layout algorithm that races several others against each other.
+ */
+
+#ifndef LAYOUT_PORTFOLIO_HPP
+#define LAYOUT_PORTFOLIO_HPP
+
+#include "data.hpp"
+#include "layout_stop.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace layout {
+
+/*
+ * algorithm to lay out a page by running a portfolio of layout
+ * routines, each with the articles in a given order, on a pool of
+ * threads.
+ *
+ * A layout using every preferred option cannot be beaten by a later
+ * candidate, so a candidate that finds one wins unless an earlier one
+ * does too: it stops the candidates after it (through their stopTokens),
+ * and any of those not yet started are skipped, while the earlier ones
+ * run on; stopWhen() stops them all. Otherwise every candidate runs to
+ * the end, and of the layouts found, the one leaving least of the page
+ * unfilled wins, ties going to the candidate added first. So the winner
+ * is the same however the threads are scheduled. With one thread the
+ * candidates run in the order they were added. With no layout, the
+ * search was exhaustive only if every candidate's was.
+ *
+ * Each candidate keeps its own state between pages, as it would on its
+ * own, and lays out its own copy of the page; the winner's layout is
+ * given back referring to the articles of p.
+ */
+class portfolio {
+public:
+  // the order a candidate is given the articles in, largest first
+  enum class ordering { area, height, width };
+private:
+  typedef std::function<const std::list<articlePlacement> &
+			(const Page &, const std::vector<int> &)> routine;
+  struct candidate {
+    std::string name_;
+    ordering order_;
+    routine run_;
+    std::function<void(const stopToken &)> stopWhen_;
+    std::function<unsigned long()> attempts_;
+  };
+  std::vector<candidate> candidates_;
+  int threads_;
+  std::list<articlePlacement> result_;
+  // the page as each candidate was given it, and where each of its
+  // articles is in the caller's page
+  std::vector<Page> pages_;
+  std::vector<std::vector<int> > orders_;
+  stopToken stop_;
+public:
+  explicit portfolio(int threads = 1) : threads_(std::max(1, threads)) {}
+
+  // add layout routine impl (which the portfolio copies) as a candidate
+  template <class T>
+  void add(const std::string & name, T impl, ordering order = ordering::area) {
+    auto r = std::make_shared<T>(impl);
+    candidates_.push_back(candidate{
+	name, order,
+	[r](const Page & p, const std::vector<int> & preferred)
+	  -> const std::list<articlePlacement> & { return (*r)(p, preferred); },
+	[r](const stopToken & stop) { r->stopWhen(stop); },
+	[r]() { return r->attempts(); }
+      });
+  }
+
+  const std::list<articlePlacement> &
+  operator()(const Page & p, const std::vector<int> & preferredArticles) {
+    const int n = candidates_.size();
+    // the unfilled area of a layout of the preferred options
+    const double best = p.width() * p.height() - p.area(preferredArticles);
+    std::vector<stopToken> stops;
+    for (int c = 0; c < n; ++c)
+      stops.push_back(stop_.child());
+    // the earliest candidate to lay out every preferred option, or n
+    std::atomic<int> perfect(n);
+    pages_.assign(n, p);
+    orders_.assign(n, std::vector<int>());
+    std::vector<const std::list<articlePlacement> *> layouts(n, 0);
+    std::vector<double> unfilled(n, HUGE_VAL);
+    // candidates that searched every layout they could make, in vain
+    std::atomic<int> proofs(0);
+
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+      for (int c = next++; c < n && !stop_.stopRequested(); c = next++) {
+	if (c > perfect) continue;
+	std::vector<int> preferred = reorder(p, preferredArticles,
+					     candidates_[c].order_, pages_[c],
+					     orders_[c]);
+	candidates_[c].stopWhen_(stops[c]);
+	try {
+	  layouts[c] = &candidates_[c].run_(pages_[c], preferred);
+	} catch (const char *error) {
+	  if (std::string(error) == "No layouts found with these article sizes.")
+	    ++proofs;
+	  continue;
+	}
+	unfilled[c] = p.width() * p.height();
+	for (auto &r : *layouts[c])
+	  unfilled[c] -= r.opt_.area();
+	if (dblGt(unfilled[c], best)) continue;
+	for (int first = perfect; c < first; )
+	  perfect.compare_exchange_weak(first, c);
+	for (int later = c + 1; later < n; ++later)
+	  stops[later].requestStop();
+      }
+    };
+    std::vector<std::thread> pool;
+    for (int i = 1; i < std::min(threads_, n); ++i)
+      pool.emplace_back(worker);
+    worker();
+    for (auto &th : pool)
+      th.join();
+
+    int winner = perfect < n ? int(perfect) : -1;
+    for (int c = 0; c < n && perfect == n; ++c)
+      if (layouts[c] && (winner < 0 || unfilled[c] < unfilled[winner]))
+	winner = c;
+    if (winner < 0 && stop_.stopRequested())
+      throw "Layout search stopped";
+    if (winner < 0 && proofs == n)
+      throw "No layouts found with these article sizes.";
+    if (winner < 0)
+      throw "No layouts found, though the search was not exhaustive.";
+    std::cout << "Portfolio layout by " << candidates_[winner].name_
+	      << " (articles by " << name(candidates_[winner].order_)
+	      << ") leaves " << unfilled[winner] << "pt^2 unfilled" << std::endl;
+    result_.clear();
+    for (auto &r : *layouts[winner]) {
+      const Article &art = p[orders_[winner][&r.art_ - &*pages_[winner].begin()]];
+      result_.emplace_back(r.area_, art, art[&r.opt_ - &*r.art_.begin()]);
+    }
+    return result_;
+  }
+
+  // placements tried by all the candidates in their last search
+  unsigned long attempts() const {
+    unsigned long total = 0;
+    for (auto &c : candidates_)
+      total += c.attempts_();
+    return total;
+  }
+  void stopWhen(const stopToken & stop) { stop_ = stop; }
+private:
+  static const char *name(ordering order) {
+    switch (order) {
+    case ordering::height: return "height";
+    case ordering::width: return "width";
+    default: return "area";
+    }
+  }
+
+  /*
+   * Copy the articles of p to page in the given order (stable, so area
+   * keeps the order they came in), returning the preferred options to
+   * match; idx is set to where each article of page is in p.
+   */
+  static std::vector<int> reorder(const Page & p, const std::vector<int> & preferred,
+				  ordering order, Page & page, std::vector<int> & idx) {
+    idx.resize(preferred.size());
+    for (unsigned int i = 0; i < idx.size(); ++i)
+      idx[i] = i;
+    auto key = [&](int i) {
+      const ArticleOption &opt = p[i][preferred[i]];
+      switch (order) {
+      case ordering::height: return opt.layoutHeight();
+      case ordering::width: return opt.layoutWidth();
+      default: return 0.0;
+      }
+    };
+    std::stable_sort(idx.begin(), idx.end(), [&](int a, int b) {
+	return key(a) > key(b);
+      });
+    std::vector<int> result;
+    for (unsigned int k = 0; k < idx.size(); ++k) {
+      page.begin()[k] = p[idx[k]];
+      result.push_back(preferred[idx[k]]);
+    }
+    return result;
+  }
+};
+
+} // namespace layout
+
+#endif // ndef LAYOUT_PORTFOLIO_HPP
@@ -0,0 +1,368 @@
+/*
+ * Template for the backtracking search over article options shared by
+ * the layout algorithms that place one article at a time.
+ */
+
+#ifndef LAYOUT_SEARCH_HPP
+#define LAYOUT_SEARCH_HPP
+
+#include "data.hpp"
+#include "debug.hpp"
+#include "layout_filter.hpp"
+#include "layout_stop.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace layout {
+
+/*
+ * Lays out the articles in page order, one at a time, by a placement
+ * rule supplied by the derived class T:
+ *
+ * void start(const Page &)           - empty the page
+ * bool place(const ArticleOption &)  - place the next article, or
+ *                                      return false, changing nothing
+ * void unplace()                     - take back the last place()
+ * const std::vector<area> & placed() const - where each article went
+ * std::vector<area> unfilled() const - free space, for reporting
+ *
+ * If the preferred options do not fit, smaller options are tried by a
+ * depth-first search in placement order: the last article placed is
+ * the first to be given a smaller option. Backtracking to article k
+ * only takes back articles k..n-1, and a prefix that leaves no room for
+ * the next article is abandoned with everything under it.
+ *
+ * Such a prefix is also remembered as a nogood, by a 128-bit hash of
+ * the page size, the shapes placed and the next article's options, for
+ * the life of the engine, in up to MAXNOGOODBYTES (roughly). Meeting it
+ * again with no larger option allowed, as news does when it retries the
+ * next best combination, it is skipped without placing anything.
+ *
+ * Interchangeable articles (Page::twins) are searched like any others:
+ * where an article goes depends on what was placed before it, so giving
+ * the smaller option to the earlier of two twins is a different layout,
+ * and may be the only one.
+ *
+ * The search is abandoned, before any placement, once the stopToken
+ * given to stopWhen() asks.
+ *
+ * With threads() above 1, the first few levels of the search are cut
+ * into tasks, one per prefix of options that places, in search order.
+ * Each thread takes its own share of the tasks from the front, lowest
+ * first, and an idle thread steals from the back of another's. Each
+ * runs the search under its prefix on its own copy of the engine, which
+ * looks up the engine's nogoods but keeps those it finds to itself
+ * until all are done. Once
+ * a task finds a layout, every later task is stopped, but earlier
+ * ones run on, and the earliest task to find one wins: the same layout
+ * the search on one thread finds.
+ */
+template <class T>
+class optionSearch {
+private:
+  std::list<articlePlacement> result_;
+  // rules out hopeless combinations before any free space is tracked
+  feasibilityFilter filter_;
+  // number of article placements tried in the last search
+  unsigned long attempts_;
+  stopToken stop_;
+  bool stopped_;
+  int threads_;
+
+  // what a nogood is known by (see nogoodKey)
+  struct nogood {
+    std::uint64_t a_, b_;
+    bool operator==(const nogood & o) const { return a_ == o.a_ && b_ == o.b_; }
+  };
+  struct nogoodHash {
+    std::size_t operator()(const nogood & key) const { return key.a_; }
+  };
+  typedef std::unordered_map<nogood, int, nogoodHash> nogoodTable;
+  // the most option of the next article tried after each nogood prefix
+  nogoodTable nogoods_;
+  // on a worker of layoutParallel, the engine's own nogoods, read-only
+  const nogoodTable *known_;
+  // prefixes skipped as nogoods in the last search
+  unsigned long nogoodHits_;
+  static const std::size_t MAXNOGOODBYTES = std::size_t(64) << 20;
+  // the table's own overhead for an entry
+  static const std::size_t NOGOOD = sizeof(nogood) + sizeof(int) + 4 * sizeof(void*);
+public:
+  optionSearch() : attempts_(0), stopped_(false), threads_(1), known_(0), nogoodHits_(0) {}
+
+  const std::list<articlePlacement> &
+  operator()(const Page & p, const std::vector<int> & preferredArticles) {
+    filter_ = feasibilityFilter();
+    attempts_ = 0;
+    stopped_ = false;
+    nogoodHits_ = 0;
+    engine().start(p);
+    std::vector<int> options = preferredArticles;
+    const bool parallel = threads_ > 1 && preferredArticles.size() > 1;
+    std::vector<area> unfilled;
+    bool found = parallel ? layoutParallel(p, preferredArticles, unfilled)
+      : layoutRecurse(p, preferredArticles, options, 0);
+    if (found && !parallel)
+      unfilled = engine().unfilled();
+    if (found)
+      std::cout << "Unfilled space is now " << unfilled << std::endl;
+    filter_.report(std::cout);
+    if (nogoodHits_)
+      std::cout << "Skipped " << nogoodHits_ << " known nogood prefixes ("
+		<< nogoods_.size() << " known)" << std::endl;
+    if (stopped_)
+      throw "Layout search stopped";
+    if (!found)
+      throw "No layouts found with these article sizes.";
+    return result_;
+  }
+
+  unsigned long attempts() const { return attempts_; }
+  unsigned long nogoodHits() const { return nogoodHits_; }
+  void stopWhen(const stopToken & stop) { stop_ = stop; }
+  void threads(int n) { threads_ = std::max(1, n); }
+private:
+  T & engine() { return static_cast<T&>(*this); }
+
+  /*
+   * As the public method, but places article k onwards, with articles
+   * before k already placed using the options in options[0..k-1].
+   * options is changed in place as the search goes. Returns true once a
+   * layout is found (in result_).
+   */
+  bool layoutRecurse(const Page & p, const std::vector<int> & preferred,
+		     std::vector<int> & options, unsigned int k) {
+    if (k == options.size()) {
+      record(p, options);
+      return true;
+    }
+    const int most = preferred[k];
+    const nogood key = nogoodKey(p, options, k);
+    if (most <= triedBefore(key)) {
+      ++nogoodHits_;
+      return false;
+    }
+    bool room = false;
+    for (int j = most; j >= 0; --j) {
+      options[k] = j;
+      if (!filter_(p, options, k+1)) continue;
+      if (stop_.stopRequested()) {
+	stopped_ = true;
+	return false;
+      }
+      ++attempts_;
+      if (!engine().place(p[k][j])) continue;
+      room = true;
+      if (layoutRecurse(p, preferred, options, k+1))
+	return true;
+      engine().unplace();
+    }
+    if (!room)
+      remember(key, most);
+    return false;
+  }
+
+  // the most option tried after a nogood, or -1 if it is not one
+  int triedBefore(const nogood & key) const {
+    int tried = -1;
+    auto found = nogoods_.find(key);
+    if (found != nogoods_.end()) tried = found->second;
+    if (known_) {
+      found = known_->find(key);
+      if (found != known_->end()) tried = std::max(tried, found->second);
+    }
+    return tried;
+  }
+
+  void remember(const nogood & key, int most) {
+    const std::size_t known = known_ ? known_->size() : 0;
+    if ((known + nogoods_.size() + 1) * NOGOOD > MAXNOGOODBYTES) return;
+    int &tried = nogoods_.emplace(key, -1).first->second;
+    tried = std::max(tried, most);
+  }
+
+  /*
+   * What a nogood is known by: the page size, the shapes of articles
+   * 0..k-1 in the given options, and the shapes of article k's options.
+   * The placement rule sees no more than that, so the same key always
+   * leaves no room for the same options. The key is two independent
+   * 64-bit hashes of those sizes, so that two prefixes are taken for
+   * each other with a chance of about 2^-128.
+   */
+  static nogood nogoodKey(const Page & p, const std::vector<int> & options,
+			  unsigned int k) {
+    nogood key{0x243f6a8885a308d3ull, 0x13198a2e03707344ull};
+    mix(key, p.width());
+    mix(key, p.height());
+    for (unsigned int i = 0; i < k; ++i) {
+      mix(key, p[i][options[i]].layoutWidth());
+      mix(key, p[i][options[i]].layoutHeight());
+    }
+    mix(key, -1);
+    for (auto &opt : p[k]) {
+      mix(key, opt.layoutWidth());
+      mix(key, opt.layoutHeight());
+    }
+    return key;
+  }
+
+  // add d to both hashes of key, each by a splitmix64 step
+  static void mix(nogood & key, double d) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &d, sizeof bits);
+    auto step = [](std::uint64_t z) {
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      return z ^ (z >> 31);
+    };
+    key.a_ = step(key.a_ ^ bits) + 0x9e3779b97f4a7c15ull;
+    key.b_ = step(key.b_ + bits * 0xd6e8feb86659fd93ull) ^ 0xa0761d6478bd642full;
+  }
+
+  // copy the completed layout to result_
+  void record(const Page & p, const std::vector<int> & options) {
+    const std::vector<area> &placed = engine().placed();
+    result_.clear();
+    for (unsigned int i = 0; i < options.size(); ++i)
+      result_.emplace_back(placed[i], p[i], p[i][options[i]]);
+  }
+
+  /*
+   * As layoutRecurse(), but only down to article depth, appending to
+   * prefixes the options of each prefix that places, in search order.
+   */
+  void collect(const Page & p, const std::vector<int> & preferred,
+	       std::vector<int> & options, unsigned int k, unsigned int depth,
+	       std::vector<std::vector<int> > & prefixes) {
+    if (k == depth) {
+      prefixes.push_back(options);
+      return;
+    }
+    for (int j = preferred[k]; j >= 0; --j) {
+      options[k] = j;
+      if (!filter_(p, options, k+1)) continue;
+      ++attempts_;
+      if (!engine().place(p[k][j])) continue;
+      collect(p, preferred, options, k+1, depth, prefixes);
+      engine().unplace();
+    }
+  }
+
+  // tasks of one thread, taken from the front by it, stolen from the back
+  struct taskQueue {
+    std::mutex lock_;
+    std::deque<int> tasks_;
+  };
+
+  // the next task for thread w, or -1 once there are none anywhere
+  static int take(std::vector<taskQueue> & queues, int w) {
+    const int n = queues.size();
+    for (int i = 0; i < n; ++i) {
+      taskQueue &q = queues[(w + i) % n];
+      std::lock_guard<std::mutex> hold(q.lock_);
+      if (q.tasks_.empty()) continue;
+      int task;
+      if (i == 0) {
+	task = q.tasks_.front();
+	q.tasks_.pop_front();
+      } else {
+	task = q.tasks_.back();
+	q.tasks_.pop_back();
+      }
+      return task;
+    }
+    return -1;
+  }
+
+  /*
+   * The search of layoutRecurse(), split into tasks across threads_
+   * threads, as described above. Leaves the free space of the layout
+   * found in unfilled.
+   */
+  bool layoutParallel(const Page & p, const std::vector<int> & preferred,
+		      std::vector<area> & unfilled) {
+    const unsigned int n = preferred.size();
+    // deep enough for several tasks a thread, leaving one article to search
+    unsigned int depth = 0;
+    for (double tasks = 1; depth + 1 < n && tasks < 8 * threads_; ++depth)
+      tasks *= preferred[depth] + 1;
+    // the workers look up the engine's nogoods, not copies of them
+    nogoodTable known;
+    known.swap(nogoods_);
+    std::vector<T> workers(threads_, engine());
+    for (auto &search : workers)
+      static_cast<optionSearch &>(search).known_ = &known;
+    std::vector<std::vector<int> > prefixes;
+    std::vector<int> options = preferred;
+    collect(p, preferred, options, 0, depth, prefixes);
+    const int count = prefixes.size();
+
+    std::vector<stopToken> stops;
+    for (int t = 0; t < count; ++t)
+      stops.push_back(stop_.child());
+    std::vector<taskQueue> queues(threads_);
+    for (int t = 0; t < count; ++t)
+      queues[long(t) * threads_ / count].tasks_.push_back(t);
+    // the earliest task to find a layout so far, or count
+    std::atomic<int> winner(count);
+    std::vector<std::list<articlePlacement> > results(count);
+    std::vector<std::vector<area> > free(count);
+
+    auto work = [&](int w) {
+      optionSearch &search = workers[w];
+      search.attempts_ = 0;
+      search.filter_ = feasibilityFilter();
+      search.nogoodHits_ = 0;
+      for (int task = take(queues, w); task >= 0; task = take(queues, w)) {
+	if (task > winner) continue;
+	std::vector<int> &opts = prefixes[task];
+	search.engine().start(p);
+	for (unsigned int k = 0; k < depth; ++k)
+	  search.engine().place(p[k][opts[k]]);
+	search.stop_ = stops[task];
+	if (!search.layoutRecurse(p, preferred, opts, depth)) continue;
+	results[task].swap(search.result_);
+	free[task] = search.engine().unfilled();
+	for (int best = winner; task < best; )
+	  winner.compare_exchange_weak(best, task);
+	for (int t = task + 1; t < count; ++t)
+	  stops[t].requestStop();
+      }
+    };
+    std::vector<std::thread> pool;
+    for (int w = 1; w < threads_; ++w)
+      pool.emplace_back(work, w);
+    work(0);
+    for (auto &th : pool)
+      th.join();
+
+    nogoods_.swap(known);
+    for (auto &search : workers) {
+      optionSearch &s = search;
+      attempts_ += s.attempts_;
+      filter_ += s.filter_;
+      nogoodHits_ += s.nogoodHits_;
+      for (auto &n : s.nogoods_)
+	remember(n.first, n.second);
+    }
+    if (winner == count) {
+      stopped_ = stop_.stopRequested();
+      return false;
+    }
+    result_.swap(results[winner]);
+    unfilled.swap(free[winner]);
+    return true;
+  }
+};
+
+} // namespace layout
+
+#endif // ndef LAYOUT_SEARCH_HPP
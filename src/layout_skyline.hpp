@@ -0,0 +1,143 @@
+/*
+ * Layout algorithm that fills the page's columns from the top down.
+ */
+
+#ifndef LAYOUT_SKYLINE_HPP
+#define LAYOUT_SKYLINE_HPP
+
+#include "data.hpp"
+#include "layout_grid.hpp"
+#include "layout_search.hpp"
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace layout {
+
+/*
+ * algorithm to lay out a page by its skyline: how far down each column
+ * has been filled.
+ *
+ * Each article goes where its top would be highest, across as many
+ * adjacent columns as it is wide (see pageGrid), leftmost first among
+ * equals. Any space in those columns above the lowest of them is lost.
+ *
+ * The fill heights are a small fixed array; the top of an article at
+ * each starting column is the maximum of a window of it, which is
+ * worked out for every column at once, two at a time with SSE2 where
+ * the compiler targets it. Smaller options are tried as described in
+ * optionSearch; the heights an article covered are kept to take it
+ * back, in space reserved when the search starts.
+ */
+class skyline : public optionSearch<skyline> {
+public:
+  static const int MAXCOLS = 64;
+private:
+  friend class optionSearch<skyline>;
+  pageGrid grid_;
+  double width_, height_;
+  // fill height of each column, padded for the vector loop
+  alignas(16) double fill_[MAXCOLS + 2];
+  // scratch: top of an article starting at each column
+  alignas(16) double top_[MAXCOLS + 2];
+  std::vector<area> placed_;
+  // first column and width in columns of each placed article,
+  // and the fill heights it covered
+  std::vector<int> cols_, widths_;
+  std::vector<double> undo_;
+
+  void start(const Page & p) {
+    grid_ = pageGrid(p, 1);
+    if (grid_.cols() > MAXCOLS)
+      throw "Too many columns for the skyline layout";
+    width_ = p.width();
+    height_ = p.height();
+    for (int c = 0; c < MAXCOLS + 2; ++c)
+      fill_[c] = 0;
+    const int n = p.end() - p.begin();
+    placed_.clear();
+    placed_.reserve(n);
+    cols_.clear();
+    cols_.reserve(n);
+    widths_.clear();
+    widths_.reserve(n);
+    undo_.clear();
+    undo_.reserve(n * grid_.cols());
+  }
+
+  // top_[c] = the highest fill of columns c..c+width-1
+  void windowMax(int width) {
+    const int cols = grid_.cols() - width + 1;
+#if defined(__SSE2__)
+    for (int c = 0; c < cols; c += 2) {
+      __m128d m = _mm_load_pd(fill_ + c);
+      for (int k = 1; k < width; ++k)
+	m = _mm_max_pd(m, _mm_loadu_pd(fill_ + c + k));
+      _mm_store_pd(top_ + c, m);
+    }
+#else
+    for (int c = 0; c < cols; ++c) {
+      double m = fill_[c];
+      for (int k = 1; k < width; ++k)
+	m = std::max(m, fill_[c + k]);
+      top_[c] = m;
+    }
+#endif
+  }
+
+  /*
+   * Place one article as high as it will go.
+   * Returns false, changing nothing, if it does not fit above the foot
+   * of the page.
+   */
+  bool place(const ArticleOption &opt) {
+    const int width = grid_.width(opt);
+    if (width > grid_.cols()) return false;
+    windowMax(width);
+    int best = 0;
+    for (int c = 1; c + width <= grid_.cols(); ++c)
+      if (top_[c] < top_[best]) best = c;
+    const double y = top_[best];
+    if (dblGt(y + opt.layoutHeight(), height_)) return false;
+
+    cols_.push_back(best);
+    widths_.push_back(width);
+    for (int c = best; c < best + width; ++c) {
+      undo_.push_back(fill_[c]);
+      fill_[c] = y + opt.layoutHeight();
+    }
+    placed_.emplace_back(opt.layoutWidth(), opt.layoutHeight(), grid_.x(best), y);
+    return true;
+  }
+
+  // take back the last place()
+  void unplace() {
+    const int first = cols_.back();
+    for (int c = first + widths_.back() - 1; c >= first; --c) {
+      fill_[c] = undo_.back();
+      undo_.pop_back();
+    }
+    cols_.pop_back();
+    widths_.pop_back();
+    placed_.pop_back();
+  }
+
+  const std::vector<area> & placed() const { return placed_; }
+
+  // the space below the skyline, a column at a time
+  std::vector<area> unfilled() const {
+    std::vector<area> result;
+    for (int c = 0; c < grid_.cols(); ++c)
+      if (dblGt(height_, fill_[c]))
+	result.emplace_back(std::min(grid_.x(c+1), width_) - grid_.x(c),
+			    height_ - fill_[c],
+			    grid_.x(c), fill_[c]);
+    return result;
+  }
+};
+
+} // namespace layout
+
+#endif // ndef LAYOUT_SKYLINE_HPP
@@ -0,0 +1,50 @@
+/*
+ * Cooperative cancellation of the layout algorithms.
+ */
+
+#ifndef LAYOUT_STOP_HPP
+#define LAYOUT_STOP_HPP
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace layout {
+
+/*
+ * Asks a layout search to give up, once requestStop() is called on it
+ * or any copy of it (from any thread), once its deadline passes, or
+ * once the token it is a child() of stops.
+ * Searches poll stopRequested() as they go, and throw
+ * "Layout search stopped" if it ends them without a layout.
+ */
+class stopToken {
+private:
+  std::shared_ptr<std::atomic<bool> > stop_;
+  std::chrono::steady_clock::time_point deadline_;
+  bool timed_;
+  std::shared_ptr<const stopToken> parent_;
+public:
+  stopToken() : stop_(std::make_shared<std::atomic<bool> >(false)), timed_(false) {}
+
+  void requestStop() const { *stop_ = true; }
+  void deadline(std::chrono::steady_clock::time_point when) {
+    deadline_ = when;
+    timed_ = true;
+  }
+  bool stopRequested() const {
+    return *stop_ || (timed_ && std::chrono::steady_clock::now() > deadline_) ||
+      (parent_ && parent_->stopRequested());
+  }
+
+  // a token that can be stopped on its own, or by this one
+  stopToken child() const {
+    stopToken c;
+    c.parent_ = std::make_shared<stopToken>(*this);
+    return c;
+  }
+};
+
+} // namespace layout
+
+#endif // ndef LAYOUT_STOP_HPP
@@ -31,6 +31,7 @@ public:
   const std::list<articlePlacement> &
   operator()(const Page & p, const std::vector<int> & preferredArticles) {
     auto res = delegate_(p,preferredArticles);
+    result_.clear();
     for (auto &i : res)
       result_.emplace_back(i);
     fit(p);
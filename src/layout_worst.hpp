@@ -7,6 +7,8 @@
 
 #include "data.hpp"
 #include "debug.hpp"
+#include "layout_free.hpp"
+#include "layout_search.hpp"
 #include <vector>
 #include <list>
 #include <memory>
@@ -89,139 +91,87 @@ struct splitSpace {
  * into the width/height of one block).
  *
  * widthFirst : true to split free space width-wise before height-wise
+ *
+ * Smaller options are tried as described in optionSearch. Each
+ * placement records how it split the free space on an undo stack, so
+ * backtracking only unwinds the splits it has to.
  */
 template <bool widthFirst = true>
-class worstFit {
+class worstFit : public optionSearch<worstFit<widthFirst> > {
 private: 
-  std::list<articlePlacement> result_;
-public:
-  const std::list<articlePlacement> & 
-  operator()(const Page & p, const std::vector<int> & preferredArticles) {
-    layoutRecurse(p, preferredArticles, preferredArticles.size()-1);
-    return result_;
+  friend class optionSearch<worstFit<widthFirst> >;
+  freeSpace free_;
+  // how each placement so far divided free_
+  std::vector<freeSpace::split> undo_;
+  // where each article placed so far went
+  std::vector<area> placed_;
+
+  void start(const Page & p) {
+    free_.reset(area(p.width(), p.height(), 0, 0));
+    undo_.clear();
+    placed_.clear();
   }
-private:
+
   /*
-   * As the public method, but uses the "start" parameter to recurse through all combinations.
-   * NB: the first option (generally the largest article) is tried for alternative sizes first in order to
-   * get the fastest option.
+   * Place one article by worst fit into free_, recording the split on
+   * undo_ and the position in placed_.
+   * Returns false, changing nothing, if the article fits nowhere.
    */
-  void layoutRecurse(const Page & p, const std::vector<int> & options, int start) {
-    if (start == -1) {
-      //std::cout << "TRYING " << options;
-      layout(p, options); // may throw
-      return;
+  bool place(const ArticleOption &opt) {
+    auto artArea = opt.area();
+    auto artWidth = opt.layoutWidth();
+    auto artHeight = opt.layoutHeight();
+
+    // find the largest area the article fits into.
+    int worst = free_.worst(artWidth, artHeight, artArea);
+    if (worst < 0) {
+      //std::cout << "Space remaining " << free_.areas() << std::endl;
+      return false;
     }
-    bool success = false;
-    for (int j = options[start]; j >= 0; --j) {
-      std::vector<int> opt = options;
-      opt[start] = j;
-      try {
-	layoutRecurse(p, opt, start-1);
-	success = true;
-	break;
-      } catch (const char* error) {
-      }
+    // now we divide the area
+    area toSplit = free_[worst].area_;
+    //      std::cout << "toSplit = " << toSplit << std::endl;
+    // we split the free space lengthways first, then widthways.
+    // -----        -----
+    // |A| |        |A| |
+    // |---|   or   |-| |
+    // |___|        |_|_|
+    area pieces[2];
+    int n = 0;
+    if (widthFirst) {
+      if (dblGt(toSplit.w_, artWidth))
+	pieces[n++] = area(toSplit.w_ - artWidth, toSplit.h_,
+			   toSplit.x_ + artWidth, toSplit.y_);
+      if (dblGt(toSplit.h_ , artHeight))
+	pieces[n++] = area(artWidth, toSplit.h_ - artHeight,
+			   toSplit.x_, toSplit.y_ + artHeight);
+    } else {
+      if (dblGt(toSplit.w_ , artWidth))
+	pieces[n++] = area(toSplit.w_ - artWidth, artHeight,
+			   toSplit.x_ + artWidth, toSplit.y_);
+      if (dblGt(toSplit.h_ , artHeight))
+	pieces[n++] = area(toSplit.w_, toSplit.h_ - artHeight,
+			   toSplit.x_, toSplit.y_ + artHeight);
     }
-    if (!success) 
-      throw "No layouts found with these article sizes.";    
+    undo_.push_back(free_.divide(worst, pieces, n));
+
+    placed_.emplace_back(artWidth, artHeight, toSplit.x_, toSplit.y_);
+    /*std::cout << "Placing article at " << placed_.back()
+	<< " (" << opt.numCols() << " columns)"
+	<< std::endl
+	<< " - space lost " << toSplit.size() - artArea << std::endl;*/
+    return true;
   }
 
-  /*
-   * Perform the actual page layout.
-   * We will attempt to use a worst-fit algorithm, dividing the page into <=4 areas for each
-   * article placed.
-   */
-  void layout(const Page & p, const std::vector<int> & options) {
-    std::list<articlePlacement> result;
-    area wholePage(p.width(), p.height(), 0, 0);
-    std::list<area> areas(1, wholePage);
-
-    int i=0;
-    for (auto idx : options) {
-      auto &art = p[i++];
-      auto &opt = art[idx];
-      auto artArea = opt.area();
-      auto artWidth = opt.layoutWidth();
-      auto artHeight = opt.layoutHeight();
-      //std::cout  << "Article #" << art.id() << " option #" << idx 
-      // << "; width = " << artWidth << ", height = " << artHeight << std::endl;
-
-      // find the smallest area large enough to fit the article.
-      double worstSpace = 0;
-      area worstArea;
-      std::list<area>::iterator worstAreaIter;
-      for (auto a = areas.begin(); a != areas.end(); ++a) {
-	// skip areas where we don't fit:
-	if (a->w_ < artWidth) continue;
-	if (a->h_ < artHeight) continue;
-	// find the worst-fitting space left:
-	double space = a->size() - artArea;
-	if (space > worstSpace) {
-	  worstSpace = space;
-	  worstArea = area(artWidth, artHeight, a->x_, a->y_);
-	  worstAreaIter = a;
-	}
-      }
-      if (worstSpace == 0) {
-	//std::cout << "Space remaining " << areas << std::endl;
-	throw "No solution found. Backtracing needed. ";
-      }
-      // now we divide the area
-      area toSplit = *worstAreaIter;
-      //      std::cout << "toSplit = " << toSplit << std::endl;
-      // we split the free space lengthways first, then widthways.
-      // -----        -----
-      // |A| |        |A| |
-      // |---|   or   |-| |
-      // |___|        |_|_|
-      if (widthFirst) {
-	if (dblGt(toSplit.w_, artWidth)) {
-	  worstAreaIter = areas.insert(worstAreaIter,
-				       area(toSplit.w_ - artWidth, toSplit.h_,
-					    toSplit.x_ + artWidth, toSplit.y_)
-				       );
-	  ++worstAreaIter;
-	}
-	if (dblGt(toSplit.h_ , artHeight)) {
-	  worstAreaIter = areas.insert(worstAreaIter, 
-				       area(artWidth, toSplit.h_ - artHeight,
-					    toSplit.x_, toSplit.y_ + artHeight)
-				       );
-	  ++worstAreaIter;
-	}
-      } else {
-	if (dblGt(toSplit.w_ , artWidth)) {
-	  worstAreaIter = areas.insert(worstAreaIter, 
-				       area(toSplit.w_ - artWidth, artHeight,
-					    toSplit.x_ + artWidth, toSplit.y_)
-				       );
-	  ++worstAreaIter;
-	}
-	if (dblGt(toSplit.h_ , artHeight)) {
-	  worstAreaIter = areas.insert(worstAreaIter,
-				       area(toSplit.w_, toSplit.h_ - artHeight,
-					    toSplit.x_, toSplit.y_ + artHeight)
-				       );
-	  ++worstAreaIter;
-	}
-      }
-      areas.erase(worstAreaIter);
-      //std::cout << "Space remaining " << areas << std::endl;
-
-      area res(artWidth, artHeight, worstArea.x_, worstArea.y_);
-      /*std::cout << "Placing article #" << art.id() << " at " << res
-	  << " (" << opt.numCols() << " columns)"
-	  << std::endl
-	  << " - space lost " << worstSpace << std::endl;*/
-      result.emplace_back(res, art, opt);
-
-    }
-    result_.clear();
-    for (auto &r : result) result_.emplace_back(r);
-    std::cout << "Unfilled space is now " << areas << std::endl;
+  // take back the last place()
+  void unplace() {
+    free_.restore(undo_.back());
+    undo_.pop_back();
+    placed_.pop_back();
   }
 
+  const std::vector<area> & placed() const { return placed_; }
+  std::vector<area> unfilled() const { return free_.areas(); }
 };
 
 } // namespace layout
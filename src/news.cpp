@@ -3,11 +3,11 @@
  */
 
 #include "data.hpp"
-#include "layout_worst.hpp"
-#include "layout_tidy.hpp"
+#include "layout_engines.hpp"
 #include "typeset.hpp"
 #include "cmdline.hpp"
 #include "process.hpp"
+#include <chrono>
 #include <iostream>
 #include <sstream>
 
@@ -105,6 +105,12 @@ Page readArtOptions(shellout &size_calculator, bool verbose) {
     }
   }
 
+  // an option both wider and taller than another can never pack better,
+  // and each one dropped divides the number of combinations to search.
+  int dominated = page.removeDominatedOptions();
+  std::cout << "Removed " << dominated << " dominated article option"
+	    << (dominated == 1 ? "" : "s") << std::endl;
+
   // tell the user what we're considering:
   std::cout << "Page size is " << page.width() << " by " << page.height() 
 	    << " ( = " << (page.width() * page.height()) << " pt^2)"
@@ -123,6 +129,80 @@ Page readArtOptions(shellout &size_calculator, bool verbose) {
   return page;
 }
 
+/*
+ * Map the --solver argument onto an option-selection algorithm.
+ */
+optionSolver parseSolver(const std::string &name) {
+  if (name == "exhaustive") return optionSolver::exhaustive;
+  if (name == "bnb") return optionSolver::branchBound;
+  if (name == "mitm") return optionSolver::meetInMiddle;
+  if (name == "dp") return optionSolver::quantizedDP;
+  throw "Unknown --solver; expected auto, exhaustive, bnb, mitm or dp";
+}
+
+/*
+ * Tell the user how many articles have the same options as an earlier
+ * one, if the search named (bnb, or the next best combinations) gives
+ * such articles their options in one order only.
+ */
+void reportTwins(const Page &p, const std::string &search) {
+  auto twins = p.twins();
+  int interchangeable = std::count_if(twins.begin(), twins.end(),
+				      [](int t) { return t >= 0; });
+  if (interchangeable)
+    std::cout << interchangeable << " article(s) interchangeable with an"
+	      << " earlier one; " << search << " skips combinations that"
+	      << " only exchange their options" << std::endl;
+}
+
+/*
+ * The --solver to use when none is given, from the base-10 log of the
+ * number of combinations of article options, with the reason.
+ * Where one half of the articles still has too many combinations for
+ * mitm, the caller falls back on bnb.
+ */
+std::string chooseSolver(double logCombinations, std::string &why) {
+  if (logCombinations <= 6) {
+    why = "few enough combinations to try every one";
+    return "exhaustive";
+  }
+  if (logCombinations <= 13) {
+    why = "exact, in time and memory near the square root of the combinations";
+    return "mitm";
+  }
+  why = "too many combinations for an exact search; time grows only with"
+    " the number of articles";
+  return "dp";
+}
+
+/*
+ * The --layout to use when none is given, from the number of articles
+ * and of combinations of their options, with the reason.
+ */
+std::string chooseLayout(const Page &p, double logCombinations, int threads,
+			 std::string &why) {
+  const int articles = p.end() - p.begin();
+  if (articles <= 10) {
+    why = "few enough articles to find the best layout by straight cuts exactly";
+    return "guillotine";
+  }
+  if (logCombinations <= 8) {
+    why = "few enough combinations for worst fit to backtrack through";
+    return "worst";
+  }
+  if (threads > 1) {
+    why = "a large search; race every algorithm on the threads given";
+    return "portfolio";
+  }
+  if (layout::pageGrid(p, 1).cols() <= 64) {
+    why = "a large search; the grid search prunes by the space left empty";
+    return "bitboard";
+  }
+  why = "a large search on too many columns for the grid; beam search"
+    " does not backtrack";
+  return "beam";
+}
+
 int main(int argc, char** argv) {
   using namespace std;
 
@@ -136,6 +216,19 @@ int main(int argc, char** argv) {
       << " --file <file>.tex"
       << " [--verbose t]"
       << " [--stage size|set|all]"
+      << " [--solver auto|exhaustive|bnb|mitm|dp]"
+      << " [--threads N]"
+      << " [--dp-quantum <sp>]"
+      << " [--retries N]"
+      << " [--layout <algorithm>]"
+      << " [--line-unit <pt>]"
+      << " [--layout-memory <MB>]"
+      << " [--beam N]"
+      << " [--restarts N]"
+      << " [--anneal-time <ms>]"
+      << " [--layout-cache N]"
+      << " [--layout-cache-file t]"
+      << " [--time-limit <ms>]"
       << std::endl
       << " --file: (required): LaTeX input source file to process"
       << std::endl
@@ -152,6 +245,109 @@ int main(int argc, char** argv) {
       << " --output-directory <dir>; passed to LaTeX"
       << std::endl
       << "          (directory will be searched for .cls file)"
+      << std::endl
+      << " --solver: how to choose the option to use for each article"
+      << std::endl
+      << "          auto (default); chosen from the number of combinations,"
+      << std::endl
+      << "              giving the reason"
+      << std::endl
+      << "          exhaustive; try every combination"
+      << std::endl
+      << "          bnb; branch-and-bound (same result, usually much faster)"
+      << std::endl
+      << "          mitm; meet-in-the-middle (same result; memory grows with"
+      << std::endl
+      << "                the square root of the number of combinations)"
+      << std::endl
+      << "          dp; dynamic programming over areas rounded up to a quantum"
+      << std::endl
+      << "              (fast for many articles; may leave a little space unused)"
+      << std::endl
+      << " --threads N: worker threads for the bnb solver and the layout"
+      << " (default 1)"
+      << std::endl
+      << " --dp-quantum <sp>: area unit of the dp solver, as the side of a"
+      << std::endl
+      << "          square in scaled points (default 65536 = 1pt)"
+      << std::endl
+      << " --retries N: if the best combination of options cannot be laid"
+      << std::endl
+      << "          out, try up to N more in descending order of area"
+      << " (default 1000)"
+      << std::endl
+      << " --layout: how to place the articles on the page"
+      << std::endl
+      << "          auto (default); chosen from the number of articles and"
+      << std::endl
+      << "              combinations, giving the reason"
+      << std::endl
+      << "          worst; worst fit, splitting free space"
+      << " width-wise first"
+      << std::endl
+      << "          worst-height; worst fit, splitting height-wise first"
+      << std::endl
+      << "          maxrects; maximal free rectangles, best short side fit"
+      << std::endl
+      << "          maxrects-area; maximal free rectangles, best area fit"
+      << std::endl
+      << "          maxrects-contact; maximal free rectangles, most contact"
+      << std::endl
+      << "          bitboard; search every placement on the column grid"
+      << std::endl
+      << "          skyline; fill the columns from the top down"
+      << std::endl
+      << "          guillotine; the best layout made by straight cuts"
+      << std::endl
+      << "              (exact; for pages of up to about 14 articles)"
+      << std::endl
+      << "          beam; beam search over the order articles are placed in"
+      << std::endl
+      << "          anneal; simulated annealing from the worst fit layout"
+      << std::endl
+      << "          portfolio; all of the above at once on --threads threads,"
+      << std::endl
+      << "              with the articles in several orders; the first to"
+      << std::endl
+      << "              lay out the preferred options wins"
+      << std::endl
+      << " --line-unit <pt>: height of a grid cell for the bitboard layout;"
+      << std::endl
+      << "          article heights are rounded up to it (default 1pt)"
+      << std::endl
+      << " --layout-memory <MB>: memory limit of the guillotine layout"
+      << " (default 512)"
+      << std::endl
+      << " --beam N: partial layouts the beam layout keeps each round"
+      << std::endl
+      << "          (default 32; 1 is greedy, more is slower but packs better)"
+      << std::endl
+      << " --restarts N: independent searches of the anneal layout"
+      << " (default 4)"
+      << std::endl
+      << " --anneal-time <ms>: time limit of the anneal layout"
+      << " (default 1000)"
+      << std::endl
+      << " --layout-cache N: remember the layouts of the last N"
+      << " combinations (default 256; 0 for none)"
+      << std::endl
+      << " --layout-cache-file: Boolean; also keep them in a file next to"
+      << std::endl
+      << "          the .lay file, for later runs"
+      << std::endl
+      << " --time-limit <ms>: stop laying out after this long (counted from"
+      << std::endl
+      << "          the start of option selection, which stops with the best"
+      << std::endl
+      << "          combination found so far),"
+      << std::endl
+      << "          with the best layout found; until then, keep trying"
+      << std::endl
+      << "          combinations that could beat it, until the best option"
+      << std::endl
+      << "          combination that this engine could lay out is found"
+      << std::endl
+      << "          (default 0: no limit, and the first layout found is used)"
       << std::endl;
     return 0;
   }
@@ -183,20 +379,156 @@ int main(int argc, char** argv) {
     std::cout << "Page has " << p.articles() << " article options " << std::endl;
 
     try {
-      auto combo = p.findBestOptions();
-      combo = p.sortArticlesBySize(combo);
-      //    p.layoutRecurse(combo);
-      auto layoutImpl = layout::worstFit<>();
-      auto layout = layout::stretchDecorator<layout::worstFit<> >(layoutImpl);
-      auto &result = layout(p, combo);
-      for (auto &r : result) {
+      const auto started = std::chrono::steady_clock::now();
+      int threads = std::max(1, std::atoi(cmd.get("threads", "1").c_str()));
+      int quantum = std::atoi(cmd.get("dp-quantum", "65536").c_str());
+      int retries = std::atoi(cmd.get("retries", "1000").c_str());
+      // choose the algorithms by the size of the search
+      const double logCombinations = p.logCombinations();
+      std::cout << "Search space is about 10^" << logCombinations
+		<< " combinations of options of " << (p.end() - p.begin())
+		<< " articles" << std::endl;
+      std::string solver = cmd.get("solver", "auto"), why;
+      const bool chosen = solver == "auto";
+      if (chosen) {
+	solver = chooseSolver(logCombinations, why);
+	std::cout << "Choosing --solver " << solver << ": " << why << std::endl;
+      } else {
+	std::cout << "Using --solver " << solver << " as given" << std::endl;
+      }
+      std::string layoutName = cmd.get("layout", "auto");
+      if (layoutName == "auto") {
+	layoutName = chooseLayout(p, logCombinations, threads, why);
+	std::cout << "Choosing --layout " << layoutName << ": " << why << std::endl;
+      } else {
+	std::cout << "Using --layout " << layoutName << " as given" << std::endl;
+      }
+      layout::engineOptions engineOpts;
+      const long timeLimit = std::atol(cmd.get("time-limit", "0").c_str());
+      if (timeLimit > 0)
+	engineOpts.stop.deadline(started + std::chrono::milliseconds(timeLimit));
+      std::vector<int> combo;
+      try {
+	if (solver == "bnb") reportTwins(p, "bnb");
+	combo = p.findBestOptions(parseSolver(solver), threads, quantum, engineOpts.stop);
+      } catch (const char* error) {
+	// the combinations can be too uneven for the halves of mitm to fit
+	if (!chosen || solver != "mitm" ||
+	    std::string(error) != "Too many option combinations for meet-in-the-middle")
+	  throw;
+	cout << error << "; choosing --solver bnb instead" << endl;
+	solver = "bnb";
+	reportTwins(p, "bnb");
+	combo = p.findBestOptions(parseSolver(solver), threads, quantum, engineOpts.stop);
+      }
+      const auto first = combo;
+      // a stopped option search may have missed better combinations
+      const bool settled = !engineOpts.stop.stopRequested();
+      engineOpts.lineUnit = std::atof(cmd.get("line-unit", "1").c_str());
+      if (!(engineOpts.lineUnit > 0))
+	throw "--line-unit must be a positive number of points";
+      engineOpts.memoryMB = std::max(1, std::atoi(cmd.get("layout-memory", "512").c_str()));
+      engineOpts.beamWidth = std::max(1, std::atoi(cmd.get("beam", "32").c_str()));
+      engineOpts.restarts = std::max(1, std::atoi(cmd.get("restarts", "4").c_str()));
+      engineOpts.annealMs = std::max(1L, std::atol(cmd.get("anneal-time", "1000").c_str()));
+      engineOpts.threads = threads;
+      auto layout = layout::makeEngine(layoutName, engineOpts);
+      const int cacheSize = std::atoi(cmd.get("layout-cache", "256").c_str());
+      if (cacheSize > 0)
+	layout = layout::cached(layout, layout::engineKey(layoutName, engineOpts),
+				cacheSize, cmd.getBool("layout-cache-file"));
+      // when the best combination will not lay out, fall back on the
+      // next best by area, generated only as far as they are tried.
+      // With a time limit, a layout that had to use smaller options is
+      // only the best so far: better combinations are tried until time
+      // runs out, or until none is left that could beat it.
+      std::unique_ptr<optionStream> fallback;
+      // the best layout so far, by the position on our copy of the page
+      // of each article and its option, as the engine may reuse the
+      // memory its layouts refer to
+      struct placing {
+	int article_, option_;
+	area area_;
+      };
+      std::unique_ptr<Page> bestPage;
+      std::vector<placing> best;
+      double bestArea = 0;
+      bool proven = false, outOfRetries = false;
+      for (int attempt = 0; ; ++attempt) {
+	// sorting reorders the articles, so lay out a copy of the page
+	std::unique_ptr<Page> page(new Page(p));
+	auto sorted = page->sortArticlesBySize(combo);
+	try {
+	  auto &result = layout(*page, sorted);
+	  double placed = 0;
+	  for (auto &r : result)
+	    placed += r.opt_.area();
+	  if (!bestPage || placed > bestArea) {
+	    best.clear();
+	    for (auto &r : result) {
+	      int i = 0;
+	      while ((*page)[i].id() != r.art_.id()) ++i;
+	      best.push_back(placing{i, int(&r.opt_ - &*r.art_.begin()), r.area_});
+	    }
+	    bestPage.swap(page);
+	    bestArea = placed;
+	  }
+	  // no later combination has more area than this one's own options
+	  if (timeLimit <= 0 || !dblLt(placed, p.area(combo))) {
+	    proven = settled;
+	    break;
+	  }
+	} catch (const char* error) {
+	  cout << error << endl;
+	}
+	if (engineOpts.stop.stopRequested())
+	  break;
+	if (attempt >= retries) {
+	  if (!bestPage)
+	    throw "No layouts found within the --retries limit";
+	  outOfRetries = true;
+	  break;
+	}
+	if (!fallback) {
+	  reportTwins(p, "the search for the next best combinations");
+	  fallback.reset(new optionStream(p, engineOpts.stop));
+	}
+	bool more;
+	do {
+	  more = fallback->next(combo);
+	} while (more && combo == first);
+	// the stream gives nothing more once stopped, which proves nothing
+	if (engineOpts.stop.stopRequested())
+	  break;
+	if (!more && !bestPage)
+	  throw "No layouts found for any combination of article options";
+	if (!more || !dblGt(p.area(combo), bestArea)) {
+	  proven = settled;
+	  break;
+	}
+	cout << "Trying next best combination: area = " << p.area(combo)
+	     << "; " << combo;
+      }
+      if (!bestPage)
+	throw "No layouts found within the --time-limit";
+      if (timeLimit > 0)
+	cout << (proven ? "Layout uses the best option combination that this engine could lay out"
+		 : outOfRetries ? "Layout is the best found within the --retries limit"
+		 : "Layout is the best found within the time limit")
+	     << " (" << bestArea << "pt^2 of articles)" << endl;
+      std::list<layout::articlePlacement> placed;
+      for (auto &b : best) {
+	const Article &art = (*bestPage)[b.article_];
+	placed.emplace_back(b.area_, art, art[b.option_]);
+      }
+      for (auto &r : placed) {
 	cout << "Placing article #" << r.art_.id() << " at " << r.area_
 	     << " (" << r.opt_.numCols() << " columns)"
 	     << std::endl;
       }
       // typeset the result into the .lay file:
       typeset::setter set;
-      set(p, result);
+      set(*bestPage, placed);
     } catch (const char* error) {
       cout << error << endl;
       return 1;
@@ -0,0 +1,807 @@
+/*
+ * Selection of article options: which option of each article to lay
+ * out so that the page is filled as fully as possible.
+ */
+
+#include "data.hpp"
+#include "areatable.hpp"
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <queue>
+#include <thread>
+
+
+combinationCursor::combinationCursor(const Page &p, int articles) :
+  page_(p),
+  area_(0),
+  changed_(-1),
+  done_(p.empty()) {
+  if (articles < 0) articles = p.end() - p.begin();
+  for (int i = 0; i < articles; ++i) {
+    if (p[i].size() == 0) done_ = true;
+    combo_.push_back(0);
+  }
+  if (done_) return;
+  // the last article changes fastest, as the original lexicographic order did
+  for (int i = combo_.size() - 1; i >= 0; --i)
+    if (p[i].size() > 1) digits_.push_back(i);
+  dir_.assign(digits_.size(), 1);
+  for (unsigned int j = 0; j <= digits_.size(); ++j)
+    focus_.push_back(j);
+  area_ = p.area(combo_);
+}
+
+/*
+ * Algorithm H: the focus pointer of the fastest digit names the digit
+ * to move; a digit that reaches either end of its range reverses and
+ * hands the focus on to the next slower digit.
+ */
+void combinationCursor::next() {
+  if (done_) return;
+  const unsigned int n = digits_.size();
+  const unsigned int j = focus_[0];
+  focus_[0] = 0;
+  if (j == n) {
+    done_ = true;
+    return;
+  }
+  const int artIdx = digits_[j];
+  const Article &art = page_[artIdx];
+  int &idx = combo_[artIdx];
+  area_ -= art[idx].area();
+  idx += dir_[j];
+  area_ += art[idx].area();
+  changed_ = artIdx;
+  if (idx == 0 || idx == art.size() - 1) {
+    dir_[j] = -dir_[j];
+    focus_[j] = focus_[j+1];
+    focus_[j+1] = j+1;
+  }
+}
+
+
+double Page::area(const std::vector<int> & combo) const {
+  double rtn = 0;
+  int j=0;
+  for (auto idx : combo)
+    rtn += arts_[j++][idx].area();
+  return rtn;
+}
+
+unsigned long long Page::combinations() const {
+  unsigned long long prod = 1;
+  for (auto &a : arts_) {
+    unsigned long long n = a.size();
+    if (n != 0 && prod > ULLONG_MAX / n)
+      throw "Too many article option combinations to count";
+    prod *= n;
+  }
+  return prod;
+}
+
+double Page::logCombinations() const {
+  double sum = 0;
+  for (auto &a : arts_)
+    sum += std::log10(double(a.size()));
+  return sum;
+}
+
+
+namespace {
+
+/*
+ * Try every combination. Largest total area no more than the page area
+ * wins; on a tie, the lexicographically first combination wins.
+ *
+ * The cursor walks all but the last two articles; at each step, every
+ * pairing of the last two articles' options is tested at once against
+ * the tail row of an areaTable. Only the few combinations whose area
+ * lands near the best so far are re-summed exactly and compared.
+ * Once stop stops, the best so far is returned.
+ */
+std::vector<int> exhaustiveSearch(const Page &p, const layout::stopToken &stop,
+				  double &bestArea) {
+  const double target = p.width() * p.height();
+  // the cursor's running total may have drifted by this much
+  const double slack = target * 1e-9;
+  std::cout << "Searching " << p.combinations() << " option combinations"
+	    << std::endl;
+  const areaTable table(p);
+  const int tailArticles = table.tailArticles();
+  const int head = (p.end() - p.begin()) - tailArticles;
+  const int lastSize = tailArticles > 0 ? p.back().size() : 1;
+  std::vector<int> bestCombo, combo;
+  bestArea = 0;
+  unsigned long steps = 0;
+  for (combinationCursor c(p, head); !c.done(); c.next()) {
+    if ((++steps & 1023) == 0 && stop.stopRequested()) break;
+    areaTable::scan(table.tail(), table.tailSize(), c.area(),
+		    bestArea - slack, target + slack,
+		    [&](int i) {
+		      combo = *c;
+		      if (tailArticles == 2) combo.push_back(i / lastSize);
+		      if (tailArticles >= 1) combo.push_back(i % lastSize);
+		      // near the best so far: re-sum exactly before comparing
+		      double area = p.area(combo);
+		      if (area > target) return;
+		      if (area > bestArea ||
+			  (area == bestArea && area > 0 && combo < bestCombo)) {
+			bestArea = area;
+			bestCombo = combo;
+		      }
+		    });
+  }
+  return bestCombo;
+}
+
+
+/*
+ * The smallest option of every article, then each article in turn
+ * raised to its largest option that still fits: what a stopped solver
+ * gives when it has found nothing better. Empty if nothing fits.
+ */
+std::vector<int> greedyOptions(const Page &p) {
+  const double target = p.width() * p.height();
+  std::vector<int> combo(p.end() - p.begin(), 0);
+  for (auto &art : p)
+    if (art.size() == 0) return std::vector<int>();
+  double total = p.area(combo);
+  if (total > target) return std::vector<int>();
+  for (unsigned int j = 0; j < combo.size(); ++j)
+    for (int i = p[j].size() - 1; i > 0; --i)
+      if (total - p[j][0].area() + p[j][i].area() <= target) {
+	total += p[j][i].area() - p[j][0].area();
+	combo[j] = i;
+	break;
+      }
+  return combo;
+}
+
+
+/*
+ * Per-article option areas and the bounds derived from them, shared
+ * read-only by every branch-and-bound search over the same page.
+ */
+struct optionTable {
+  const double target_;
+  // rounding allowance when comparing bounds against the target or best
+  const double slack_;
+  // option areas for each article, ascending
+  std::vector<std::vector<double> > areas_;
+  // index of the first option of the largest area, for each article
+  std::vector<int> largest_;
+  // minRest_[k], maxRest_[k]: least and greatest area of articles k..n-1
+  std::vector<double> minRest_, maxRest_;
+  // nearest earlier article with the same options, or -1 (Page::twins)
+  std::vector<int> twin_;
+  // false if some article has no options at all
+  bool viable_;
+
+  optionTable(const Page &p) :
+    target_(p.width() * p.height()),
+    slack_(target_ * 1e-9),
+    twin_(p.twins()),
+    viable_(true) {
+    for (auto &art : p) {
+      std::vector<double> a;
+      for (auto &opt : art) a.push_back(opt.area());
+      areas_.push_back(a);
+      largest_.push_back(a.empty() ? 0 :
+			 std::lower_bound(a.begin(), a.end(), a.back()) - a.begin());
+    }
+    const int n = areas_.size();
+    minRest_.assign(n+1, 0);
+    maxRest_.assign(n+1, 0);
+    for (int k = n-1; k >= 0; --k) {
+      if (areas_[k].empty()) viable_ = false;
+      else {
+	minRest_[k] = minRest_[k+1] + areas_[k].front();
+	maxRest_[k] = maxRest_[k+1] + areas_[k].back();
+      }
+    }
+  }
+
+  int size() const { return areas_.size(); }
+
+  /*
+   * Greedily raise each article to its largest option that still fits,
+   * to give a bound worth pruning against before any search. Only the
+   * bound is used; the search itself must find the lexicographically
+   * first combination that reaches it.
+   */
+  double seed() const {
+    if (!viable_) return 0;
+    double total = minRest_[0];
+    for (auto &a : areas_) {
+      for (int i = a.size() - 1; i > 0; --i)
+	if (total - a.front() + a[i] <= target_) {
+	  total += a[i] - a.front();
+	  break;
+	}
+    }
+    return total <= target_ - slack_ ? total - slack_ : 0;
+  }
+};
+
+
+/*
+ * Depth-first branch-and-bound over the options of each article in turn.
+ *
+ * Options are visited in index order, which is ascending area, so the
+ * search meets combinations in the same lexicographic order as the
+ * exhaustive search and breaks ties the same way. Partial sums are
+ * accumulated in article order, so leaf areas are bit-for-bit those of
+ * Page::area().
+ *
+ * A subtree is abandoned when even the smallest remaining options
+ * overflow the page, or when even the largest cannot beat the best found.
+ * A subtree where even the largest options fit is settled at once by
+ * taking them. The search stops as soon as the page is exactly filled.
+ *
+ * When several searches share a bound, each prunes against the best area
+ * any of them has published, but only strictly below it, so that equal
+ * answers from earlier prefixes survive to the final tie-break.
+ *
+ * A search may be confined to a subspace: the leading options fixed, and
+ * some options of the next article excluded. The bounds stay valid, as
+ * restricting the options can only narrow the true range of areas.
+ *
+ * Interchangeable articles (those with the same options) are only given
+ * options in non-decreasing order, as any other assignment is a
+ * permutation of one of these with the same area. The non-decreasing
+ * one is also the lexicographically first of its permutations, so the
+ * tie-break is unaffected.
+ *
+ * A stopToken, if given, is polled every few thousand nodes; once it
+ * stops, the search unwinds with the best it has found so far.
+ */
+class boundedSearch {
+private:
+  const optionTable &t_;
+  std::atomic<double> *shared_;
+  const layout::stopToken *stop_;
+  std::vector<int> combo_;
+  // options excluded for article exclDepth_, if any
+  std::vector<char> excluded_;
+  int exclDepth_;
+  bool filled_;
+  unsigned long nodes_;
+  bool stopped_;
+public:
+  std::vector<int> best_;
+  double bestArea_;
+
+  /*
+   * seeded: start from a greedy bound over the whole page; this must be
+   * false when the search is confined to a subspace the greedy choice
+   * may lie outside.
+   */
+  boundedSearch(const optionTable &t, std::atomic<double> *shared = nullptr,
+		bool seeded = true, const layout::stopToken *stop = nullptr) :
+    t_(t),
+    shared_(shared),
+    stop_(stop),
+    combo_(t.size(), 0),
+    exclDepth_(-1),
+    filled_(false),
+    nodes_(0),
+    stopped_(false),
+    bestArea_(seeded ? t.seed() : 0) {}
+
+  /*
+   * Search every completion of the given leading options, without the
+   * options flagged in excluded for the article after them.
+   * Returns true if anything beat the best found so far.
+   */
+  bool run(const std::vector<int> &prefix = std::vector<int>(),
+	   const std::vector<char> &excluded = std::vector<char>()) {
+    if (!t_.viable_) return false;
+    double sum = 0;
+    unsigned int k = 0;
+    for (; k < prefix.size(); ++k) {
+      combo_[k] = prefix[k];
+      sum += t_.areas_[k][prefix[k]];
+      if (t_.twin_[k] >= 0 && prefix[k] < prefix[t_.twin_[k]]) return false;
+    }
+    if (!excluded.empty()) {
+      excluded_ = excluded;
+      exclDepth_ = k;
+    }
+    if (sum + t_.minRest_[k] > t_.target_ + t_.slack_) return false;
+    const double before = bestArea_;
+    search(k, sum);
+    return bestArea_ > before && !best_.empty();
+  }
+
+  bool filled() const { return filled_; }
+  bool stopped() const { return stopped_; }
+
+private:
+  bool stopping() {
+    if (!stopped_ && stop_ && (++nodes_ & 4095) == 0)
+      stopped_ = stop_->stopRequested();
+    return stopped_;
+  }
+
+  double bound() const {
+    if (!shared_) return bestArea_;
+    return std::max(bestArea_, shared_->load(std::memory_order_relaxed));
+  }
+
+  void leaf(double sum) {
+    if (sum > t_.target_) return;
+    if (sum > bestArea_) {
+      bestArea_ = sum;
+      best_ = combo_;
+      filled_ = (sum == t_.target_);
+      if (shared_) {
+	double cur = shared_->load(std::memory_order_relaxed);
+	while (sum > cur && !shared_->compare_exchange_weak(cur, sum, std::memory_order_relaxed))
+	  ;
+      }
+    }
+  }
+
+  void search(int k, double sum) {
+    const int n = t_.size();
+    if (stopping()) return;
+    if (k == n) {
+      leaf(sum);
+      return;
+    }
+    if (k > exclDepth_ && sum + t_.maxRest_[k] <= t_.target_ - t_.slack_) {
+      // everything fits: the largest options are the best completion
+      double total = sum;
+      for (int j = k; j < n; ++j) {
+	combo_[j] = t_.largest_[j];
+	if (t_.twin_[j] >= 0)
+	  combo_[j] = std::max(combo_[j], combo_[t_.twin_[j]]);
+	total += t_.areas_[j][t_.largest_[j]];
+      }
+      leaf(total);
+      return;
+    }
+    auto &a = t_.areas_[k];
+    const unsigned int from = t_.twin_[k] < 0 ? 0 : combo_[t_.twin_[k]];
+    for (unsigned int i = from; i < a.size() && !filled_ && !stopped_; ++i) {
+      if (k == exclDepth_ && excluded_[i]) continue;
+      double s = sum + a[i];
+      if (s + t_.minRest_[k+1] > t_.target_ + t_.slack_) break; // larger options overflow too
+      if (s + t_.maxRest_[k+1] < bound() - t_.slack_) continue;
+      combo_[k] = i;
+      search(k+1, s);
+    }
+  }
+};
+
+
+/*
+ * Branch-and-bound on several threads.
+ *
+ * The leading articles' options are split into lexicographically
+ * numbered prefixes, which workers claim in turn. Each worker searches
+ * below its prefix against the best area any worker has published.
+ * The winner is the largest area, with ties going to the lowest
+ * prefix, which is exactly the combination the serial search returns.
+ * Once stop stops, workers claim no more prefixes.
+ */
+std::vector<int> parallelSearch(const optionTable &t, int threads,
+				const layout::stopToken &stop, double &bestArea) {
+  const int n = t.size();
+  // enough prefixes that workers finishing early can keep busy
+  const unsigned long long wanted = 16ull * threads;
+  unsigned long long prefixes = 1;
+  int depth = 0;
+  while (depth < n && prefixes < wanted) {
+    prefixes *= t.areas_[depth].size();
+    ++depth;
+  }
+
+  std::atomic<double> shared(t.seed());
+  std::atomic<unsigned long long> next(0);
+  // lowest prefix known to fill the page exactly; later ones can stop
+  std::atomic<unsigned long long> filledAt(prefixes);
+  std::vector<std::vector<int> > best(prefixes);
+  std::vector<double> area(prefixes, 0);
+
+  auto worker = [&]() {
+    std::vector<int> prefix(depth);
+    for (unsigned long long i = next++; i < prefixes && i < filledAt && !stop.stopRequested();
+	 i = next++) {
+      // decode i into the options of the leading articles
+      unsigned long long rest = i;
+      for (int k = depth-1; k >= 0; --k) {
+	prefix[k] = rest % t.areas_[k].size();
+	rest /= t.areas_[k].size();
+      }
+      boundedSearch search(t, &shared, true, &stop);
+      if (search.run(prefix)) {
+	best[i] = search.best_;
+	area[i] = search.bestArea_;
+      }
+      if (search.filled()) {
+	unsigned long long cur = filledAt;
+	while (i < cur && !filledAt.compare_exchange_weak(cur, i))
+	  ;
+      }
+    }
+  };
+  std::vector<std::thread> pool;
+  for (int i = 0; i < threads; ++i)
+    pool.emplace_back(worker);
+  for (auto &th : pool)
+    th.join();
+
+  std::vector<int> rtn;
+  bestArea = 0;
+  for (unsigned long long i = 0; i < prefixes; ++i)
+    if (!best[i].empty() && area[i] > bestArea) {
+      bestArea = area[i];
+      rtn = best[i];
+    }
+  return rtn;
+}
+
+
+typedef std::pair<double, unsigned int> rankedSum;
+
+/*
+ * Every sum of one option from each article in [from, to), ascending,
+ * each with its rank: the mixed-radix number of the options chosen, so
+ * lexicographic order. Sums accumulate in article order. Of equal sums
+ * only the lowest rank is kept, as the others would pair no better.
+ *
+ * Each article is added by merging one sorted run per option (adding
+ * the same area keeps sums in order), so the work can stop between
+ * runs: once stop stops, the result is empty.
+ */
+std::vector<rankedSum> halfSums(const Page &p, int from, int to,
+				const layout::stopToken &stop) {
+  // a larger half would not fit comfortably in memory
+  const unsigned long long LIMIT = 1ull << 24;
+  unsigned long long count = 1;
+  for (int j = from; j < to; ++j) {
+    count *= p[j].size();
+    if (count > LIMIT)
+      throw "Too many option combinations for meet-in-the-middle";
+  }
+  std::vector<rankedSum> sums(1, rankedSum(0.0, 0)), run, merged;
+  for (int j = from; j < to; ++j) {
+    const unsigned int size = p[j].size();
+    std::vector<rankedSum> next;
+    for (unsigned int i = 0; i < size; ++i) {
+      if (stop.stopRequested()) return std::vector<rankedSum>();
+      const double a = p[j][i].area();
+      run.clear();
+      for (auto &s : sums) {
+	const rankedSum r(s.first + a, s.second * size + i);
+	// distinct sums can round to the same one
+	if (!run.empty() && run.back().first == r.first)
+	  run.back().second = std::min(run.back().second, r.second);
+	else
+	  run.push_back(r);
+      }
+      merged.resize(next.size() + run.size());
+      std::merge(next.begin(), next.end(), run.begin(), run.end(), merged.begin());
+      next.swap(merged);
+    }
+    // equal sums are in rank order: keep the first of each
+    next.erase(std::unique(next.begin(), next.end(),
+			   [](const rankedSum & x, const rankedSum & y) {
+			     return x.first == y.first;
+			   }), next.end());
+    sums.swap(next);
+  }
+  return sums;
+}
+
+/*
+ * Meet-in-the-middle: enumerate and sort the sums of each half of the
+ * articles separately, then sweep one list upwards against the other
+ * downwards to find the largest pair that fits. The articles are split
+ * where the two halves have the nearest numbers of combinations, which
+ * takes about 2 x sqrt(N) log N work for N combinations, rather than N.
+ *
+ * The sweep adds sums of halves, which can round differently from
+ * Page::area(): pairs within rounding of the page are re-summed to find
+ * the best that really fits, and a second sweep re-sums exactly every
+ * pair within rounding of that best, and keeps the lexicographically first of the
+ * largest, as the exhaustive search does. Once stop stops, nothing is
+ * returned.
+ */
+std::vector<int> meetInMiddle(const Page &p, const layout::stopToken &stop,
+			      double &bestArea) {
+  const double target = p.width() * p.height();
+  const double slack = target * 1e-9;
+  const int n = p.end() - p.begin();
+  bestArea = 0;
+  for (auto &art : p)
+    if (art.size() == 0) return std::vector<int>();
+
+  // split where the larger half has fewest combinations
+  double logAll = 0;
+  for (auto &art : p)
+    logAll += std::log(art.size());
+  int half = 0;
+  double logFirst = 0, bestLarger = logAll;
+  for (int k = 1; k <= n; ++k) {
+    logFirst += std::log(p[k-1].size());
+    const double larger = std::max(logFirst, logAll - logFirst);
+    if (larger < bestLarger) {
+      bestLarger = larger;
+      half = k;
+    }
+  }
+
+  // (sum, rank) for each half, ascending by sum
+  typedef rankedSum ranked;
+  const std::vector<ranked> a = halfSums(p, 0, half, stop);
+  const std::vector<ranked> b = halfSums(p, half, n, stop);
+  if (a.empty() || b.empty()) return std::vector<int>();
+
+  std::vector<int> combo(n), bestCombo;
+  auto decode = [&](unsigned int rank, int from, int to) {
+    for (int k = to - 1; k >= from; --k) {
+      combo[k] = rank % p[k].size();
+      rank /= p[k].size();
+    }
+  };
+  auto exact = [&](const ranked & x, const ranked & y) {
+    decode(x.second, 0, half);
+    decode(y.second, half, n);
+    return p.area(combo);
+  };
+
+  // first sweep: the best total that really fits, to within rounding;
+  // a pair within rounding of the page may overflow it when re-summed
+  double best = -1;
+  int j = b.size() - 1;
+  for (auto &x : a) {
+    while (j >= 0 && x.first + b[j].first > target + slack) --j;
+    if (j < 0) break;
+    int k = j;
+    while (k >= 0 && x.first + b[k].first > target - slack && exact(x, b[k]) > target)
+      --k;
+    if (k >= 0) best = std::max(best, x.first + b[k].first);
+  }
+  if (best <= 0) return std::vector<int>();
+
+  // second sweep: settle every near-best pair exactly
+  int hi = b.size() - 1;
+  for (auto &x : a) {
+    while (hi >= 0 && x.first + b[hi].first > target + slack) --hi;
+    if (hi < 0) break;
+    for (int k = hi; k >= 0 && x.first + b[k].first >= best - slack; --k) {
+      double area = exact(x, b[k]);
+      if (area > target) continue;
+      if (area > bestArea || (area == bestArea && combo < bestCombo)) {
+	bestArea = area;
+	bestCombo = combo;
+      }
+    }
+  }
+  return bestCombo;
+}
+
+
+/*
+ * Multiple-choice knapsack by dynamic programming over quantised area.
+ *
+ * Areas are counted in units of quantum x quantum (quantum in TeX
+ * scaled points, 65536sp = 1pt). Option areas are rounded up and the
+ * page area down, so whatever this picks really fits; it may miss a
+ * better fill by up to one unit per article.
+ *
+ * reach[j] is a bitset of the unit totals reachable with one option from
+ * each of the first j articles; reach[j+1] is the union of reach[j]
+ * shifted by each option of article j. Keeping every layer lets the
+ * choice be read back from the best reachable total. The work is
+ * linear in the number of articles. Once stop stops, nothing is
+ * returned.
+ */
+std::vector<int> quantizedDP(const Page &p, int quantum,
+			     const layout::stopToken &stop, double &bestArea) {
+  typedef unsigned long long word;
+  const int BITS = 64;
+  // the tables would need more than this many bytes
+  const unsigned long long LIMIT = 512ull * 1024 * 1024;
+  const int n = p.end() - p.begin();
+  bestArea = 0;
+  if (quantum <= 0) throw "The dp quantum must be a positive number of scaled points";
+  const double pt = quantum / 65536.0;
+  const double unit = pt * pt;
+  // checked as a double, before it is narrowed, as it may fit no integer
+  const double capUnits = std::floor(p.width() * p.height() / unit);
+  if (!(capUnits / BITS + 1 <= double(LIMIT) / sizeof(word) / (n + 1)))
+    throw "Quantum too fine for the dp solver on this page";
+  const long long cap = capUnits;
+  const std::size_t words = cap / BITS + 1;
+
+  // options bigger than the page are left out (-1)
+  std::vector<std::vector<long long> > units(n);
+  for (int j = 0; j < n; ++j)
+    for (auto &opt : p[j]) {
+      const double u = std::ceil(opt.area() / unit);
+      units[j].push_back(u > capUnits ? -1 : (long long)u);
+    }
+
+  std::vector<std::vector<word> > reach(n + 1, std::vector<word>(words, 0));
+  reach[0][0] = 1;
+  for (int j = 0; j < n; ++j) {
+    if (stop.stopRequested()) return std::vector<int>();
+    const std::vector<word> &in = reach[j];
+    std::vector<word> &out = reach[j+1];
+    for (long long u : units[j]) {
+      if (u < 0) continue;
+      const std::size_t ws = u / BITS;
+      const int bs = u % BITS;
+      for (std::size_t w = words; w-- > ws; ) {
+	word v = in[w - ws] << bs;
+	if (bs && w > ws) v |= in[w - ws - 1] >> (BITS - bs);
+	out[w] |= v;
+      }
+    }
+    // bits beyond the page capacity are not reachable
+    out[words - 1] &= (~word(0)) >> (BITS - 1 - cap % BITS);
+  }
+
+  long long best = cap;
+  while (best > 0 && !(reach[n][best / BITS] >> (best % BITS) & 1)) --best;
+  if (best <= 0) return std::vector<int>();
+
+  // read the choice back, last article first
+  std::vector<int> combo(n);
+  long long s = best;
+  for (int j = n - 1; j >= 0; --j) {
+    for (unsigned int i = 0; i < units[j].size(); ++i) {
+      if (units[j][i] < 0) continue;
+      long long prev = s - units[j][i];
+      if (prev >= 0 && (reach[j][prev / BITS] >> (prev % BITS) & 1)) {
+	combo[j] = i;
+	s = prev;
+	break;
+      }
+    }
+  }
+  bestArea = p.area(combo);
+  return combo;
+}
+
+} // namespace
+
+
+/*
+ * Lawler's k-best scheme (as Murty's for assignments): each entry of
+ * the queue is a disjoint subspace of combinations with the best
+ * combination found in it. Popping the best entry yields the next
+ * combination; the rest of its subspace is then split into pieces that
+ * each fix one more leading option and exclude the popped combination's
+ * choice at the article after, and each piece is searched for its own
+ * best before being queued.
+ */
+class optionStream::impl {
+private:
+  struct subspace {
+    // leading options fixed in this subspace
+    std::vector<int> prefix_;
+    // options excluded for the article after the prefix
+    std::vector<char> excluded_;
+    // best combination in the subspace, and its area
+    std::vector<int> best_;
+    double area_;
+  };
+  struct worse {
+    // larger areas first; ties go to the lexicographically first combination
+    bool operator()(const subspace &a, const subspace &b) const {
+      if (a.area_ != b.area_) return a.area_ < b.area_;
+      return b.best_ < a.best_;
+    }
+  };
+  optionTable table_;
+  layout::stopToken stop_;
+  std::priority_queue<subspace, std::vector<subspace>, worse> queue_;
+  int emitted_;
+
+  void push(subspace s) {
+    boundedSearch search(table_, nullptr, false, &stop_);
+    // a stopped search may have missed its subspace's best
+    if (search.run(s.prefix_, s.excluded_) && !search.stopped()) {
+      s.best_ = search.best_;
+      s.area_ = search.bestArea_;
+      queue_.push(s);
+    }
+  }
+public:
+  impl(const Page &p, const layout::stopToken &stop) :
+    table_(p),
+    stop_(stop),
+    emitted_(0) {
+    push(subspace());
+  }
+
+  bool next(std::vector<int> &combo) {
+    if (queue_.empty() || stop_.stopRequested()) return false;
+    subspace top = queue_.top();
+    queue_.pop();
+    combo = top.best_;
+    ++emitted_;
+    // partition the rest of top's subspace
+    const int n = table_.size();
+    for (int k = top.prefix_.size(); k < n; ++k) {
+      subspace piece;
+      piece.prefix_.assign(combo.begin(), combo.begin() + k);
+      if (k == (int)top.prefix_.size() && !top.excluded_.empty())
+	piece.excluded_ = top.excluded_;
+      else
+	piece.excluded_.assign(table_.areas_[k].size(), 0);
+      piece.excluded_[combo[k]] = 1;
+      push(piece);
+    }
+    return true;
+  }
+
+  int emitted() const { return emitted_; }
+};
+
+optionStream::optionStream(const Page &p, const layout::stopToken &stop) :
+  pImpl_(new impl(p, stop)) {}
+optionStream::~optionStream() {}
+bool optionStream::next(std::vector<int> &combo) {
+  return pImpl_->next(combo);
+}
+int optionStream::emitted() const {
+  return pImpl_->emitted();
+}
+
+
+/*
+ * Returns a vector of indicies, in article order.
+ * Each index is the offset within the list of options for that article.
+ * eg [3,2,5] would mean the 3rd option for the first article, the 2nd for the next, and the 5th for the third.
+ */
+std::vector<int> Page::findBestOptions(optionSolver solver, int threads,
+				       int quantum, const layout::stopToken &stop) const {
+  std::vector<int> bestCombo;
+  double bestArea = 0;
+  switch (solver) {
+  case optionSolver::exhaustive:
+    bestCombo = exhaustiveSearch(*this, stop, bestArea);
+    break;
+  case optionSolver::branchBound: {
+    optionTable table(*this);
+    if (threads > 1) {
+      bestCombo = parallelSearch(table, threads, stop, bestArea);
+    } else {
+      boundedSearch search(table, nullptr, true, &stop);
+      search.run();
+      bestCombo = search.best_;
+      bestArea = search.bestArea_;
+    }
+    break;
+  }
+  case optionSolver::meetInMiddle:
+    bestCombo = meetInMiddle(*this, stop, bestArea);
+    break;
+  case optionSolver::quantizedDP:
+    bestCombo = quantizedDP(*this, quantum, stop, bestArea);
+    break;
+  }
+
+  if (stop.stopRequested()) {
+    std::cout << "Option search stopped; using the best found so far" << std::endl;
+    if (bestCombo.empty()) {
+      bestCombo = greedyOptions(*this);
+      bestArea = area(bestCombo);
+    }
+  }
+
+  if (bestCombo.empty()) {
+    throw "No solution without page overflow";
+  }
+
+  using namespace std;
+  cout << "Best result: area = " << bestArea << "; " << bestCombo << endl;
+
+  return bestCombo;
+}
@@ -14,7 +14,8 @@ namespace typeset {
 		  const std::pair<double, double> & end) const;
   };
 
-  setter::setter() {}
+  setter::setter() :
+    pImpl_(new impl()) {}
   setter::~setter() {}
   void setter::operator()(const Page &p, const std::list<::layout::articlePlacement> & placements) {
     (*pImpl_)(p, placements);